@@ -3,38 +3,296 @@
 #include <malloc.h>
 
 #include "freertos/FreeRTOS.h"
+#include "freertos/timers.h"
 #include "driver/gpio.h"
 #include "esp8266/rom_functions.h"
 #include "task.h"
 
+#include "esp_attr.h"
 #include "esp_log.h"
 #include "esp_system.h"
 
 #include "dht22.h"
+#include "dht22_event.h"
+
+#if DHT_USE_FAST_GPIO == 1
+#include "esp8266/eagle_soc.h"
+#include "esp8266/gpio_register.h"
+#endif
+
+#if DHT_USE_DMA_CAPTURE == 1
+#include "driver/i2s.h"
+#include "esp8266/pin_mux_register.h"
+#endif
 
 #define DHT_LOW  0
 #define DHT_HIGH 1
 
-#define BEGIN_READ_CYCLE_LOW          10 // in milli-seconds
-#define BEGIN_READ_CYCLE_HIGH         40 // in micro-seconds
-#define BEGIN_READ_CYCLE_DHT_LOW      80 // in micro-seconds
-#define BEGIN_READ_CYCLE_DHT_HIGH     80 // in micro-seconds
-#define BEGIN_DATA_READ_DHT_ATTENTION 50 // in micro-seconds 
-#define BEGIN_DATA_RECEIVE_DHT_DATA   70 // in micro-seconds
+// protocol timing, set per build in dht22_config.h
+#define BEGIN_READ_CYCLE_LOW          DHT_START_LOW_MS  // in milli-seconds
+#define BEGIN_READ_CYCLE_HIGH         DHT_START_HIGH_US // in micro-seconds
+#define BEGIN_READ_CYCLE_DHT_LOW      DHT_RESPONSE_US   // in micro-seconds
+#define BEGIN_READ_CYCLE_DHT_HIGH     DHT_RESPONSE_US   // in micro-seconds
+#define BEGIN_DATA_READ_DHT_ATTENTION DHT_BIT_LOW_US    // in micro-seconds 
+#define BEGIN_DATA_RECEIVE_DHT_DATA   DHT_BIT_ONE_US    // in micro-seconds
+
+#define DHT_BENCH_SAMPLES          10000 // polls per path in bench mode
+
+// nominal phase lengths in micro-seconds, histogram buckets are a quarter of this wide
+#define DHT_NOMINAL_START_US          (BEGIN_READ_CYCLE_LOW * 1000 + BEGIN_READ_CYCLE_HIGH)
+#define DHT_NOMINAL_PAYLOAD_US        (40 * (BEGIN_DATA_READ_DHT_ATTENTION + DHT_BIT_THRESHOLD_US))
+#define DHT_NOMINAL_TOTAL_US          (DHT_NOMINAL_START_US + BEGIN_READ_CYCLE_DHT_LOW + \
+                                       BEGIN_READ_CYCLE_DHT_HIGH + DHT_NOMINAL_PAYLOAD_US)
+
+#if DHT_USE_FAST_GPIO == 1
+#define DHT_MULTI_MAX_SENSORS         16 // GPIO0-15 share the GPIO_IN register
+#define DHT_MULTI_PULSES              42 // pre-response HIGH + response HIGH + 40 bits
+#define DHT_MULTI_FRAME_TIMEOUT     6500 // in micro-seconds, slowest legal frame is ~5.2ms
+#endif
+
+// learned power-up settle time, see dhtPowerLearn
+#define DHT_POWER_SETTLE_MIN_MS     100 // never read sooner after power-up
+#define DHT_POWER_SETTLE_STEP_MS     20 // smallest change of the learned settle time
+
+// start signal length for the async timer, never less than one tick
+#define DHT_START_SIGNAL_TICKS        (pdMS_TO_TICKS(BEGIN_READ_CYCLE_LOW) > 0 ? pdMS_TO_TICKS(BEGIN_READ_CYCLE_LOW) : 1)
+
+// dhtReadAsync progress
+typedef enum _dhtasyncstate_t {
+    DHT_ASYNC_IDLE,
+    DHT_ASYNC_START_SIGNAL,     // DATA held LOW, waiting for the timer
+    DHT_ASYNC_CAPTURE           // ISR capture armed, waiting for frame or timeout
+}dhtasyncstate_t;
+
+// ROM routine, returns CPU clock in MHz (80 or 160)
+extern uint32_t ets_get_cpu_frequency(void);
+
+// read DATA line level; the fast path reads GPIO_IN directly (GPIO0-15 only)
+#if DHT_USE_FAST_GPIO == 1
+#define DHT_READ_PIN(pin) ((int)((GPIO_REG_READ(GPIO_IN_ADDRESS) >> (pin)) & 0x1))
+#else
+#define DHT_READ_PIN(pin) gpio_get_level(pin)
+#endif
+
+#if DHT_USE_ISR_CAPTURE == 1
+#define DHT_ISR_CAPTURE_TIMEOUT       20 // in milli-seconds, a full frame takes ~5ms
+#define DHT_MAX_EDGES                 88 // 4 edges for start/response + 80 data edges + slack
+#define DHT_RESPONSE_FALLING_EDGES    42 // response LOW + response HIGH end + 40 bits
+
+// edge timestamps captured by the GPIO ISR during one frame
+typedef struct _dhtcapture {
+    volatile uint8_t edgeCount;
+    volatile uint8_t fallingCount;
+    uint8_t          pin;
+    TaskHandle_t     waiter;                    // task blocked until frame completes
+    void *           owner;                     // dht_t with an async capture in flight
+    uint32_t         ccount[DHT_MAX_EDGES];     // CCOUNT at each edge
+    uint8_t          level[DHT_MAX_EDGES];      // line level right after each edge
+}dhtcapture_t;
+
+static bool gIsrServiceInstalled = false;
+#endif
+
+#if DHT_USE_DMA_CAPTURE == 1
+#define DHT_DMA_PIN               GPIO_NUM_12 // MTDI, the only pin routed to I2SI_DATA
+#define DHT_DMA_SAMPLES_PER_US       1 // 16-bit stereo frames at 31.25kHz clock in 1 bit per us
+#define DHT_DMA_SAMPLE_RATE      31250
+#define DHT_DMA_CAPTURE_US        6500 // response and slowest legal payload, like DHT_MULTI_FRAME_TIMEOUT
+#define DHT_DMA_MIN_RUN_US           4 // shorter pulses are glitches, a real phase is >= 26us
+#define DHT_DMA_WORDS             ((DHT_DMA_CAPTURE_US * DHT_DMA_SAMPLES_PER_US + 31) / 32 * 2)
+#define DHT_DMA_MAX_EDGES           96 // initial level + 4 start/response edges + 80 data edges + slack
+#define DHT_DMA_READ_TIMEOUT        20 // in milli-seconds, the buffer fills in DHT_DMA_CAPTURE_US
+
+// one frame's samples and the edges run-length decoded from them; there is one
+// I2S receiver, so one buffer serves every read
+typedef struct _dhtdma {
+    uint16_t words[DHT_DMA_WORDS];          // line samples, earliest in the MSB of words[0]
+    uint32_t ccount[DHT_DMA_MAX_EDGES];     // sample index of each edge
+    uint8_t  level[DHT_DMA_MAX_EDGES];      // line level right after each edge
+}dhtdma_t;
+
+static bool     gI2sInstalled = false;
+static dhtdma_t gDma;
+#endif
+
+// outputs of one polled capture, filled by dhtCaptureBits
+typedef struct _dhtpoll {
+    int      bit;                   // failing bit, -1 if it failed in the response
+    uint32_t elapsed;               // cycles spent in the phase that timed out
+    uint32_t maxGap;                // longest cycles between two DATA samples, i.e. preemption
+    uint32_t masked;                // cycles spent with interrupts masked
+    uint32_t threshold;             // bit threshold the payload was decoded with
+    uint32_t phases[DHT_PHASE_MAX]; // response and payload cycles, valid when DHT_OK
+}dhtpoll_t;
 
 // Forward references
-dht_result_t dhtReadRawData(dht_t *, uint8_t *);
-dht_result_t dhtProcessRawData(uint8_t *, dht_data_t *);
+struct _dhtpvt;
+static dht_result_t dhtCheckInitInput(uint8_t, char *, dht_t **);
+static dht_result_t dhtSetup(uint8_t, char *, dht_t *, struct _dhtpvt *);
+dht_result_t dhtReadRawData(dht_t *, uint8_t *, uint32_t);
+static bool dhtReadIntervalElapsed(dht_t *);
+static dht_result_t dhtCheckReadInterval(dht_t *);
+static dht_result_t dhtReadFrame(dht_t *, dht_raw_t *, const char *);
+static bool dhtReadFromCache(dht_t *, dht_raw_t *);
+static void dhtCacheResult(dht_t *, const uint8_t *);
+static void dhtClearStats(void *);
+static void dhtRecordResult(dht_t *, dht_result_t);
+static dht_result_t dhtSendStartSignal(dht_t *);
+static dht_result_t dhtPollFrame(dht_t *, uint8_t *, uint32_t);
+static dht_result_t dhtCaptureBits(uint8_t, uint8_t *, uint32_t, uint32_t, dhtpoll_t *);
+static void dhtRecordJitter(dht_t *, uint32_t, uint32_t, uint32_t);
+static void dhtNoteThreshold(dht_t *, uint32_t, uint32_t);
+static void dhtPowerSwitch(dht_t *, bool);
+static void dhtPowerPrepare(dht_t *);
+static void dhtPowerAfterRead(dht_t *, dht_result_t);
+static void dhtPowerLearn(struct _dhtpvt *, uint32_t, bool);
+static dht_result_t dhtValidateFrame(uint8_t, const uint8_t *);
+dht_result_t dhtProcessRawData(uint8_t, const uint8_t *, dht_data_t *);
+#if DHT_USE_ISR_CAPTURE == 1
+dht_result_t dhtReadRawDataIsr(dht_t *, uint8_t *, uint32_t);
+static dht_result_t dhtIsrBeginCapture(dht_t *, TaskHandle_t);
+static dht_result_t dhtIsrEndCapture(dht_t *, uint8_t *, uint32_t);
+static void dhtAsyncCaptureDone(void *, uint32_t);
+#endif
+#if DHT_USE_DMA_CAPTURE == 1
+dht_result_t dhtReadRawDataDma(dht_t *, uint8_t *, uint32_t);
+#endif
+static void dhtAsyncTimerCallback(TimerHandle_t);
+#if DHT_USE_FAST_GPIO == 1
+static void dhtCaptureMulti(const uint8_t *, uint8_t, uint8_t (*)[DHT_FRAME_SIZE], uint8_t *, uint8_t *, uint32_t *, uint32_t, uint32_t *, uint32_t *);
+#endif
+static void dhtAsyncComplete(dht_t *, dht_result_t, const uint8_t *);
 
 static const char *DHT_TAG = "DHT22";
 
+// CCOUNT cycles spent in each protocol phase of the read in flight
+typedef struct _dhttiming {
+    uint32_t start;                     // CCOUNT when the start signal began
+    uint8_t  measured;                  // bit per dht_phase_t set in cycles
+    uint32_t cycles[DHT_PHASE_MAX];
+}dhttiming_t;
+
+static const uint32_t gPhaseNominalUs[DHT_PHASE_MAX] = {
+    DHT_NOMINAL_TOTAL_US,
+    DHT_NOMINAL_START_US,
+    BEGIN_READ_CYCLE_DHT_LOW,
+    BEGIN_READ_CYCLE_DHT_HIGH,
+    DHT_NOMINAL_PAYLOAD_US
+};
+
 // private struct to capture context
 typedef struct _dhtpvt {
     void *   pDhtAddress;   // address of DHT pointer
     uint32_t successCount;
     uint32_t errorCount;
+    uint32_t cacheHits;
+    uint32_t results[DHT_RESULT_MAX];
+    dht_latency_t latency[DHT_PHASE_MAX];       // avgUs unused, see latencySumUs
+    uint64_t      latencySumUs[DHT_PHASE_MAX];
+    dhttiming_t   timing;
+    bool          pooled;       // lives in gDhtPool, dhtCleanup releases the slot instead of freeing
+    uint8_t       bitThresholdUs;   // bit 0/1 split, kept across deep sleep by dhtSaveState
+    uint8_t       frameThresholdUs; // split the last capture used, learned once its checksum passes
+    uint32_t      jitterLastUs;     // see dht_stats_t
+    uint32_t      jitterMaxUs;
+    uint32_t      maskedMaxUs;
+    #if DHT_USE_ISR_CAPTURE == 1
+    dhtcapture_t capture;
+    #endif
+    TimerHandle_t    asyncTimer;    // drives the async start signal and capture timeout
+    volatile uint8_t asyncState;    // dhtasyncstate_t
+    dht_callback_t   asyncCallback;
+    void *           asyncArg;
+    TaskHandle_t     asyncTask;     // notified on completion when asyncCallback is NULL
+    dht_result_t     asyncResult;
+    dht_data_t       asyncData;
+    bool             hasLastGood;   // lastGood holds a valid frame
+    TickType_t       lastGoodTicks; // tick count of the start signal that produced lastGood
+    uint8_t          lastGood[DHT_FRAME_SIZE];  // decoded again on a cache hit
+    bool             powerSwitched; // power holds the supply switch, see dhtSetPower
+    dht_power_t      power;
+    bool             powered;
+    bool             powerFresh;    // no capture since power-up yet, its outcome trains powerSettleMs
+    TickType_t       powerOnTicks;
+    uint16_t         powerSettleMs; // learned power-up to read wait
+    uint16_t         powerFailMs;   // longest wait the sensor did not answer after, the learning floor
+    uint8_t          noResponseRun; // consecutive reads without a response
+    uint32_t         powerCycles;
 }dhtpvt_t;
 
+#if DHT_STATIC_POOL_SIZE > 0
+// dhtInitializeStatic storage, sized at compile time so its RAM is fixed
+typedef struct _dhtslot {
+    dht_t    dht;
+    dhtpvt_t pvt;
+    bool     used;
+}dhtslot_t;
+
+static dhtslot_t gDhtPool[DHT_STATIC_POOL_SIZE];
+#endif
+
+// Xtensa CCOUNT register, increments once per CPU clock cycle
+static inline __attribute__((always_inline)) uint32_t
+dhtGetCycleCount(void) {
+    uint32_t ccount;
+    __asm__ __volatile__("rsr %0, ccount" : "=a"(ccount));
+    return ccount;
+}
+
+// HIGH-phase width in cycles above which a data bit reads as 1
+static inline uint32_t
+dhtBitThreshold(dht_t *pDht) {
+    return ((dhtpvt_t *)pDht->opaque)->bitThresholdUs * ets_get_cpu_frequency();
+}
+
+// Store cycles spent in 'phase' of the read in flight
+static inline __attribute__((always_inline)) void
+dhtMarkPhase(dhttiming_t *pTiming, dht_phase_t phase, uint32_t cycles) {
+    pTiming->cycles[phase] = cycles;
+    pTiming->measured |= 1 << phase;
+}
+
+// Spin while DATA line holds 'level'. Returns cycles spent, which is
+// greater than 'timeout' if the line never changed. *pMaxGap is raised to
+// the longest stretch between two samples, which only an interrupt or a
+// task switch makes longer than one loop pass.
+static inline __attribute__((always_inline)) uint32_t
+dhtMeasureLevel(uint8_t pin, int level, uint32_t timeout, uint32_t *pMaxGap) {
+    uint32_t start = dhtGetCycleCount();
+    uint32_t last = start;
+    uint32_t maxGap = *pMaxGap;
+    uint32_t elapsed = 0;
+    while (DHT_READ_PIN(pin) == level) {
+        uint32_t now = dhtGetCycleCount();
+        if (now - last > maxGap) {
+            maxGap = now - last;
+        }
+        last = now;
+        elapsed = now - start;
+        if (elapsed > timeout) {
+            break;
+        }
+    }
+    *pMaxGap = maxGap;
+    return elapsed;
+}
+
+#if DHT_CRITICAL_CAPTURE == 1
+// Raise the interrupt level to 3, masking every interrupt except the NMI
+// (the WiFi MAC), and return the previous PS for dhtRestoreInterrupts
+static inline __attribute__((always_inline)) uint32_t
+dhtMaskInterrupts(void) {
+    uint32_t ps;
+    __asm__ __volatile__("rsil %0, 3" : "=a"(ps) :: "memory");
+    return ps;
+}
+
+static inline __attribute__((always_inline)) void
+dhtRestoreInterrupts(uint32_t ps) {
+    __asm__ __volatile__("wsr %0, ps; rsync" :: "a"(ps) : "memory");
+}
+#endif
+
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
  * dhtInitalize- Public method to initialize structs to read from DHT Sensor.
  * 
@@ -48,33 +306,9 @@ typedef struct _dhtpvt {
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
 dht_result_t
 dhtInitialize(uint8_t pinId, char *name, dht_t **ppDht) {
-    if (!GPIO_IS_VALID_GPIO(pinId)) {
-        ESP_LOGE(DHT_TAG, "DHT::initialize: Pin '%d' is not valid!", pinId);
-        return DHT_INVALID_INPUT;
-    }
-
-    if (name == NULL || name[0] == 0) {
-        ESP_LOGE(DHT_TAG, "DHT::initialize: 'name' invalid, cannot be NULL or empty!");
-        return DHT_INVALID_INPUT;
-    }
-
-    bool nullTerminated = false;
-    for (int x=0; x<DHT_MAX_SENSOR_NAME; x++) {
-        if (name[x] == 0) {
-            nullTerminated = true;
-            break;
-        }
-    }
-
-    if (nullTerminated == false) {
-        name[DHT_MAX_SENSOR_NAME-1] = 0;
-        ESP_LOGW(DHT_TAG, "DHT::initialize: 'name' invalid, not null-terminated. \  
-                           Clipping to max allowed. name = '%s'. (%d)", name, __LINE__);
-    }
- 
-    if (ppDht == NULL) {
-        ESP_LOGE(DHT_TAG, "DHT::initialize: Pointer to return-value cannot be null!");    
-        return DHT_INVALID_INPUT;
+    dht_result_t result = dhtCheckInitInput(pinId, name, ppDht);
+    if (result != DHT_OK) {
+        return result;
     }
 
     dhtpvt_t *pDhtpvt = malloc(sizeof(dhtpvt_t));
@@ -90,25 +324,63 @@ dhtInitialize(uint8_t pinId, char *name, dht_t **ppDht) {
         return DHT_MALLOC_FAILED;    
     }
 
-    if (gpio_set_pull_mode(pinId, GPIO_PULLUP_ONLY) != ESP_OK) {
-        ESP_LOGE(DHT_TAG, "DHT::initialize: Failed to set pin '%d' to PULLUP.", pinId);
+    result = dhtSetup(pinId, name, pDht, pDhtpvt);
+    if (result != DHT_OK) {
         free(pDhtpvt);
         free(pDht);
-        return DHT_FAILED_TO_SET_PIN_MODE;
-    } 
-
-    #if DEBUG == 1
-    ESP_LOGI(DHT_TAG, "DHT::initialize: dhtpvt ptr=0x%x, pdht ptr=0x%x (%d)", (uint32_t)pDhtpvt, (uint32_t)pDht, __LINE__);
-    #endif
+        return result;
+    }
 
-    pDhtpvt->pDhtAddress = (void *)pDht;
-    pDht->pin = pinId;
-    pDht->pc = 0;
-    pDht->opaque = (void *)pDhtpvt;
     *ppDht = pDht;
     return DHT_OK;
 }
 
+#if DHT_STATIC_POOL_SIZE > 0
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ * dhtInitializeStatic - Public method to initialize a sensor in a slot of the
+ *                       static pool instead of on the heap.
+ * 
+ * Inputs
+ *      same as dhtInitialize.
+ *
+ * Returns dht_result_t, DHT_MALLOC_FAILED when all DHT_STATIC_POOL_SIZE slots
+ * are in use. dhtCleanup hands the slot back.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+dht_result_t
+dhtInitializeStatic(uint8_t pinId, char *name, dht_t **ppDht) {
+    dht_result_t result = dhtCheckInitInput(pinId, name, ppDht);
+    if (result != DHT_OK) {
+        return result;
+    }
+
+    dhtslot_t *pSlot = NULL;
+    taskENTER_CRITICAL();
+    for (int x=0; x<DHT_STATIC_POOL_SIZE; x++) {
+        if (!gDhtPool[x].used) {
+            pSlot = &gDhtPool[x];
+            pSlot->used = true;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    if (pSlot == NULL) {
+        ESP_LOGE(DHT_TAG, "DHT::initializeStatic: all %d pool slots in use! (%d)", DHT_STATIC_POOL_SIZE, __LINE__);
+        return DHT_MALLOC_FAILED;
+    }
+
+    result = dhtSetup(pinId, name, &pSlot->dht, &pSlot->pvt);
+    if (result != DHT_OK) {
+        pSlot->used = false;
+        return result;
+    }
+
+    pSlot->pvt.pooled = true;
+    *ppDht = &pSlot->dht;
+    return DHT_OK;
+}
+#endif
+
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
  * dhtCleanup- Public method to cleanup DHT pointer.
  * 
@@ -134,248 +406,1853 @@ dhtCleanup(dht_t** ppDht) {
         ESP_LOGE(DHT_TAG, "DHT::cleanup: Invalid pDht pointer provided, will not free memory! (%d)", __LINE__);
         return DHT_INVALID_INPUT;
     } 
-        
+
+    if (pvt->asyncState != DHT_ASYNC_IDLE) {
+        ESP_LOGE(DHT_TAG, "DHT::cleanup: Async read in progress, will not free memory! (%d)", __LINE__);
+        return DHT_BUSY;
+    }
+
+    if (pvt->asyncTimer != NULL) {
+        xTimerDelete(pvt->asyncTimer, portMAX_DELAY);
+        pvt->asyncTimer = NULL;
+    }
+
+    // a stale dht_t copy must not pass the address check again
+    pvt->pDhtAddress = NULL;
+
+    #if DHT_STATIC_POOL_SIZE > 0
+    if (pvt->pooled) {
+        for (int x=0; x<DHT_STATIC_POOL_SIZE; x++) {
+            if (&gDhtPool[x].pvt == pvt) {
+                gDhtPool[x].used = false;
+                break;
+            }
+        }
+        *ppDht = NULL;
+        return DHT_OK;
+    }
+    #endif
+
+    free(pvt);
     free(*ppDht);
     *ppDht = NULL;
     return DHT_OK;
 }
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
- * dhtRead - Public method to initiate read from DHT and return readable results.
+ * dhtCheckInitInput - Private method to validate dhtInitialize arguments,
+ *                     clips a name that is not null-terminated.
  *
  * Returns dht_result_t.
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
-dht_result_t 
-dhtRead(dht_t *pDht, dht_data_t *outdata) {
-    if (pDht == NULL) {
-        ESP_LOGE(DHT_TAG, "DHT::read: input 'dht' cannot be NULL.");
+static dht_result_t
+dhtCheckInitInput(uint8_t pinId, char *name, dht_t **ppDht) {
+    if (!GPIO_IS_VALID_GPIO(pinId)) {
+        ESP_LOGE(DHT_TAG, "DHT::initialize: Pin '%d' is not valid!", pinId);
         return DHT_INVALID_INPUT;
     }
 
-    if (outdata == NULL) {
-        ESP_LOGE(DHT_TAG, "DHT::read: input 'outdata' cannot be NULL.");
+    #if DHT_USE_FAST_GPIO == 1
+    if (pinId == GPIO_NUM_16) {
+        ESP_LOGE(DHT_TAG, "DHT::initialize: Pin '%d' is not in GPIO_IN, build with DHT_USE_FAST_GPIO=0 to use it!", pinId);
         return DHT_INVALID_INPUT;
     }
+    #endif
 
-    TickType_t ticks = xTaskGetTickCount(); 
-    if ((ticks - pDht->pc) < pdMS_TO_TICKS(2000)) {
-        ESP_LOGE(DHT_TAG, "DHT::read: call frequency cannot be less than 2 seconds. ticks=%ld, pc=%ld", ticks, pDht->pc);
-        return DHT_READ_QUERY_TOO_FREQUENT;
-    }
- 
-    // buffer to capture DHT22 sensor input
-    uint8_t b[40] = {0};
-
-    dht_result_t result = dhtReadRawData(pDht, b);
-    if (result == DHT_OK) {
-        result = dhtProcessRawData(b, outdata);
+    #if DHT_USE_DMA_CAPTURE == 1
+    if (pinId != DHT_DMA_PIN) {
+        ESP_LOGE(DHT_TAG, "DHT::initialize: Pin '%d' is not routed to the I2S receiver, DMA capture needs GPIO%d! (%d)", pinId, DHT_DMA_PIN, __LINE__);
+        return DHT_INVALID_INPUT;
     }
+    #endif
 
-    return result;
-}
-
-/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
- *  dhtReadRawData - Private method to read data from DHT bus.
- *  
- *  Inputs
- *      pDht:   pointer to pin info
- *      b   :   pointer to raw data buffer (40 bytes)
- *
- *  Returns dht_result_t  
- * 
- *  Read bus line to get Temperature & Humidity data.
- *
- *  Notes 
- *      Algo from DHT22 spec sheet:
- *          1. Read interval should be greater than 2 seconds.
- *          2. To begin read cycle:
- *              a. MCU Pulls DATA LOW for 1-10ms   (start signal)
- *              b. MCU Pulls DATA HIGH for 20-40us (wait for response)
- *              c. DHT responds with 80us LOW
- *              d. DHT responds with 80us HIGH
- *              e. Response cycle
- *                  i.   50us LOW
- *                  ii.  1-bit DATA --> 26-28us = 0, 70us = 1 
- *                  iii. repeat 40 times 
- * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
-dht_result_t
-dhtReadRawData(dht_t *pDht, uint8_t *b) {
-   if (gpio_set_direction(pDht->pin, GPIO_MODE_OUTPUT) != ESP_OK) {
-        ESP_LOGE(DHT_TAG, "DHT::read: failed to set pin:%d direction to OUTPUT. (%d)", pDht->pin, __LINE__);
-        return DHT_FAILED_TO_SET_PIN_DIRECTION;;
-    } 
-    
-    // START time-sensitive code.
-    // send LOW signal to get DHT sensor's attention 
-    if (gpio_set_level(pDht->pin, DHT_LOW) != ESP_OK) {
-        ESP_LOGE(DHT_TAG, "DHT::read: failed to set pin:%d to LOW. (%d)", pDht->pin, __LINE__);
-        return DHT_FAILED_TO_SET_PIN_LEVEL;
+    if (name == NULL || name[0] == 0) {
+        ESP_LOGE(DHT_TAG, "DHT::initialize: 'name' invalid, cannot be NULL or empty!");
+        return DHT_INVALID_INPUT;
     }
 
-    vTaskDelay(pdMS_TO_TICKS(BEGIN_READ_CYCLE_LOW));
-
-    // send HIGH signal to tell DHT sensor that MCU is ready to receive data
-    if (gpio_set_level(pDht->pin, DHT_HIGH) != ESP_OK) {
-        ESP_LOGE(DHT_TAG, "DHT::read: failed to set pin:%d to HIGH. (%d)", pDht->pin, __LINE__);
-        return DHT_FAILED_TO_SET_PIN_LEVEL;
+    bool nullTerminated = false;
+    for (int x=0; x<DHT_MAX_SENSOR_NAME; x++) {
+        if (name[x] == 0) {
+            nullTerminated = true;
+            break;
+        }
     }
 
-    ets_delay_us(BEGIN_READ_CYCLE_HIGH);
-
-    // DHT sensor should be in LOW state after this delay
-    // set port direction to input
-    if (gpio_set_direction(pDht->pin, GPIO_MODE_INPUT) != ESP_OK) {
-        ESP_LOGE(DHT_TAG, "DHT::read: failed to set pin:%d direction to INPUT. (%d)", pDht->pin, __LINE__);
-        return DHT_FAILED_TO_SET_PIN_DIRECTION;
+    if (nullTerminated == false) {
+        name[DHT_MAX_SENSOR_NAME-1] = 0;
+        ESP_LOGW(DHT_TAG, "DHT::initialize: 'name' invalid, not null-terminated. \  
+                           Clipping to max allowed. name = '%s'. (%d)", name, __LINE__);
     }
-
-    int prevState;
-    int counter=0;
-    // Wait for DHT sensor to ready itself to send info: 
-    // DHT sensor will stay LOW for 80us
-    while (counter++ < BEGIN_READ_CYCLE_DHT_LOW && (prevState = gpio_get_level(pDht->pin)) == DHT_LOW) {
-        ets_delay_us(1);
+ 
+    if (ppDht == NULL) {
+        ESP_LOGE(DHT_TAG, "DHT::initialize: Pointer to return-value cannot be null!");    
+        return DHT_INVALID_INPUT;
     }
 
-    if(prevState == DHT_LOW) {
-        ESP_LOGE(DHT_TAG, "DHT::read: DHT22 sensor did not switch to HIGH in 80us. counter=%d. (%d)", counter, __LINE__);
-        return DHT_SENSOR_DID_NOT_SWITCH_TO_HIGH;
-    }
+    return DHT_OK;
+}
 
-    counter = 0;
-    // DHT sensor will stay HIGH for 80us
-    while (counter++ < BEGIN_READ_CYCLE_DHT_HIGH && (prevState = gpio_get_level(pDht->pin)) == DHT_HIGH) {
-        ets_delay_us(1);
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ * dhtSetup - Private method to configure the pin and fill in a dht_t and its
+ *            dhtpvt_t, wherever their storage came from.
+ *
+ * Returns dht_result_t, nothing needs undoing on failure.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static dht_result_t
+dhtSetup(uint8_t pinId, char *name, dht_t *pDht, dhtpvt_t *pDhtpvt) {
+    if (gpio_set_pull_mode(pinId, GPIO_PULLUP_ONLY) != ESP_OK) {
+        ESP_LOGE(DHT_TAG, "DHT::initialize: Failed to set pin '%d' to PULLUP.", pinId);
+        return DHT_FAILED_TO_SET_PIN_MODE;
     } 
 
-    if(prevState == DHT_HIGH) {
-        ESP_LOGE(DHT_TAG, "DHT::read: DHT22 sensor did not switch to LOW in 80us. counter=%d (%d)", counter,  __LINE__);
-        return DHT_SENSOR_DID_NOT_SWITCH_TO_LOW;
+    #if DHT_USE_ISR_CAPTURE == 1
+    if (!gIsrServiceInstalled) {
+        if (gpio_install_isr_service(0) != ESP_OK) {
+            ESP_LOGE(DHT_TAG, "DHT::initialize: Failed to install GPIO ISR service. (%d)", __LINE__);
+            return DHT_FAILED_TO_SET_PIN_MODE;
+        }
+        gIsrServiceInstalled = true;
     }
+    #endif
 
-    // DHT sensor in LOW state, begin reading bits
-    for (int x=0;x<40;x++) {
-        // Now begin receiving data, DHT sensor is in HIGH state
-        // 50us LOW followed by variable signal:
-        //      ~28us = HIGH 
-        //      ~70us = HIGH 
-        counter = 0;
-        while (counter++ < BEGIN_DATA_READ_DHT_ATTENTION && (prevState = gpio_get_level(pDht->pin)) == DHT_LOW) {
-            ets_delay_us(1);
-        } 
-
-        if(prevState == DHT_LOW) {
-            ESP_LOGE(DHT_TAG, "DHT::read: DHT22 sensor did not switch to HIGH in 50us. counter=%d (%d)", counter, __LINE__);
-            return DHT_SENSOR_DID_NOT_SWITCH_TO_HIGH;
-        }
- 
-        counter = 0;
-        while (counter++ < BEGIN_DATA_RECEIVE_DHT_DATA && (prevState = gpio_get_level(pDht->pin)) == DHT_HIGH) {
-            ets_delay_us(1);
-        }
+    #if DHT_USE_DMA_CAPTURE == 1
+    if (!gI2sInstalled) {
+        i2s_config_t config = {
+            .mode = I2S_MODE_MASTER | I2S_MODE_RX,
+            .sample_rate = DHT_DMA_SAMPLE_RATE,
+            .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+            .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
+            .communication_format = I2S_COMM_FORMAT_I2S | I2S_COMM_FORMAT_I2S_MSB,
+            .dma_buf_count = 4,
+            .dma_buf_len = DHT_DMA_WORDS / 8,   // in stereo frames, 4 buffers hold one capture
+            .tx_desc_auto_clear = false
+        };
 
-        if (prevState == DHT_HIGH) {
-            ESP_LOGE(DHT_TAG, "DHT::read: DHT22 sensor did not set bus to LOW. counter=%d (%d)", counter, __LINE__);
-            return DHT_SENSOR_DID_NOT_SWITCH_TO_LOW;
+        if (i2s_driver_install(I2S_NUM_0, &config, 0, NULL) != ESP_OK) {
+            ESP_LOGE(DHT_TAG, "DHT::initialize: Failed to install I2S driver. (%d)", __LINE__);
+            return DHT_FAILED_TO_SET_PIN_MODE;
         }
 
-        // store the counter value to analyze bit-value later
-        b[40-(x+1)] = counter;
+        // the receiver only runs for the duration of a read
+        i2s_stop(I2S_NUM_0);
+        gI2sInstalled = true;
     }
-    
-    // END time-sensitive code. 
+    #endif
+
+    // slots are reused, start from a clean context
+    memset(pDhtpvt, 0, sizeof(dhtpvt_t));
+
+    #if DHT_USE_ISR_CAPTURE == 1
+    pDhtpvt->capture.pin = pinId;
+    pDhtpvt->capture.waiter = NULL;
+    pDhtpvt->capture.owner = NULL;
+    #endif
+
+    pDhtpvt->asyncTimer = NULL;
+    pDhtpvt->asyncState = DHT_ASYNC_IDLE;
+    pDhtpvt->asyncCallback = NULL;
+    pDhtpvt->asyncArg = NULL;
+    pDhtpvt->asyncTask = NULL;
+    pDhtpvt->asyncResult = DHT_OK;
+    pDhtpvt->hasLastGood = false;
+    pDhtpvt->lastGoodTicks = 0;
+    pDhtpvt->pooled = false;
+    pDhtpvt->bitThresholdUs = DHT_BIT_THRESHOLD_US;
+    dhtClearStats(pDhtpvt);
 
     #if DEBUG == 1
-    ESP_LOGI(DHT_TAG, "DHT::read:RH: [%d] [%d] [%d] [%d] [%d] [%d] [%d] [%d]", b[39], b[38], b[37], b[36], b[35], b[34], b[33], b[32]);
-    ESP_LOGI(DHT_TAG, "DHT::read:RH: [%d] [%d] [%d] [%d] [%d] [%d] [%d] [%d]", b[31], b[30], b[29], b[28], b[27], b[26], b[25], b[24]);
-    ESP_LOGI(DHT_TAG, "DHT::read:TP: [%d] [%d] [%d] [%d] [%d] [%d] [%d] [%d]", b[23], b[22], b[21], b[20], b[19], b[18], b[17], b[16]);
-    ESP_LOGI(DHT_TAG, "DHT::read:TP: [%d] [%d] [%d] [%d] [%d] [%d] [%d] [%d]", b[15], b[14], b[13], b[12], b[11], b[10], b[9], b[8]);
-    ESP_LOGI(DHT_TAG, "DHT::read:CS: [%d] [%d] [%d] [%d] [%d] [%d] [%d] [%d]", b[7], b[6], b[5], b[4], b[3], b[2], b[1], b[0]);
+    ESP_LOGI(DHT_TAG, "DHT::initialize: dhtpvt ptr=0x%x, pdht ptr=0x%x (%d)", (uint32_t)pDhtpvt, (uint32_t)pDht, __LINE__);
     #endif
 
+    pDhtpvt->pDhtAddress = (void *)pDht;
+    strncpy(pDht->name, name, DHT_MAX_SENSOR_NAME-1);
+    pDht->name[DHT_MAX_SENSOR_NAME-1] = 0;
+    pDht->pin = pinId;
+    pDht->pc = 0;
+    pDht->opaque = (void *)pDhtpvt;
     return DHT_OK;
 }
 
-/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
- *  dhtProcessRawData - Private Method to convert raw DHT sensor data to Temp, 
- *                      RH, and Checksum 
- *  
- *  Inputs
- *      b      : pointer to raw data buffer (40 bytes) 
- *      outdata: pointer to dht_data_t struct
- 8
- *  Returns - dht_result_t
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ * dhtRead - Public method to initiate read from DHT and return readable results.
  *
- *  Notes 
- *           i.  16 bits RH       - Convert to decimal and divide by 10. 
- *                                  Range 0-100%
- *           ii. 16 bits T        - Convert to decimal and divide by 10. 
- *                                  Range -40-80C, -40-176F
- *                                  High order bit=1 means negative T
- *           iii. 8 bits CHECKSUM - Lower Order 8 bits of SUM(i + ii) 
- * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
-dht_result_t
-dhtProcessRawData(uint8_t *b, dht_data_t *outdata) {
-    /*
-     *  Buffer Map:
-     *      Relative Humidity = buffer[39]...buffer[24] 
-     *      Temperature       = buffer[23]...buffer[8]
-     *      Checsum           = buffer[7]...buffer[0]
-     */
-
-    uint32_t rh=0;
-    // Get RH
-    for (int x=39;x>23;x--) {
-        rh |= b[x] > 19 ? (uint8_t)0x1 : (uint8_t)0x0; 
-        rh <<= x>24 ? 1 : 0;        // don't shift last bit
-    }
-
-    // Get TEMP
-    // highest order bit if 1 means negative temperature
-    bool isNegative = b[23] > 19 ? true : false;
-    uint32_t temp=0;
-    for (int x=22;x>7;x--) {
-        temp |= b[x] > 19 ? (uint8_t)0x1 : (uint8_t)0x0; 
-        temp <<= x>8 ? 1 : 0;       // don't shift last bit
+ * Returns dht_result_t.
+ *
+ * Notes
+ *      Within DHT_MIN_READ_INTERVAL of the previous start signal the last 
+ *      valid reading is returned instead, with fromCache set and ageMs 
+ *      telling how old it is. DHT_READ_QUERY_TOO_FREQUENT is only returned 
+ *      when no valid reading exists yet.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+dht_result_t 
+dhtRead(dht_t *pDht, dht_data_t *outdata) {
+    if (pDht == NULL) {
+        ESP_LOGE(DHT_TAG, "DHT::read: input 'dht' cannot be NULL.");
+        return DHT_INVALID_INPUT;
     }
 
-    if (isNegative) {
-        temp *= -1;
+    if (outdata == NULL) {
+        ESP_LOGE(DHT_TAG, "DHT::read: input 'outdata' cannot be NULL.");
+        return DHT_INVALID_INPUT;
     }
 
-    // Get CHECKSUM
-    uint32_t checksum=0;
-    for (int x=7;x>-1;x--) {
-        checksum |= b[x] > 19 ? (uint8_t)0x1 : (uint8_t)0x0;
-        checksum <<= x>0 ? 1 : 0;   // don't shift last bit
+    dht_raw_t raw;
+    dht_result_t result = dhtReadFrame(pDht, &raw, "read");
+    if (result == DHT_OK) {
+        dhtDecodeRaw(&raw, outdata);
     }
 
-    // validate sensor reading against checksum
-    // sum up the 4 bytes that make up the RH+TEMP 
-    // readings individually and keep the lower 8 bits.
-    uint32_t calculated_checksum = ((rh & 0x0000ff00) >> 8) + (rh & 0x000000ff) + ((temp & 0x0000ff00) >> 8) + (temp & 0x000000ff);
-    calculated_checksum &= 0x0000ff;
+    return result;
+}
 
-    if (checksum != calculated_checksum) {
-        ESP_LOGE(DHT_TAG, "DHT::read: Checksum failure! CS=0x%x, Calculated-CS=0x%x. (%d)", checksum, calculated_checksum, __LINE__);
-        return DHT_INVALID_CHECKSUM;
-    }
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ * dhtReadRaw - Public method to read the validated frame without converting it.
+ *
+ * Returns dht_result_t.
+ *
+ * Notes
+ *      Runs the same capture, checksum and cache as dhtRead and leaves
+ *      the conversion to the caller (dhtDecodeRaw or the dhtFrame* 
+ *      helpers), which can run in another task or not at all.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+dht_result_t
+dhtReadRaw(dht_t *pDht, dht_raw_t *outraw) {
+    if (pDht == NULL) {
+        ESP_LOGE(DHT_TAG, "DHT::readRaw: input 'dht' cannot be NULL.");
+        return DHT_INVALID_INPUT;
+    }
+
+    if (outraw == NULL) {
+        ESP_LOGE(DHT_TAG, "DHT::readRaw: input 'outraw' cannot be NULL.");
+        return DHT_INVALID_INPUT;
+    }
+
+    return dhtReadFrame(pDht, outraw, "readRaw");
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtReadFrame - Private method behind dhtRead and dhtReadRaw: serve the 
+ *                 cache or capture and validate a fresh frame.
+ *
+ *  Inputs
+ *      pDht  : pointer to pin info
+ *      pRaw  : receives frame and capture tick
+ *      caller: public method name for the log
+ *
+ *  Returns dht_result_t, counted in the stats.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static dht_result_t
+dhtReadFrame(dht_t *pDht, dht_raw_t *pRaw, const char *caller) {
+    if (((dhtpvt_t *)pDht->opaque)->asyncState != DHT_ASYNC_IDLE) {
+        ESP_LOGE(DHT_TAG, "DHT::%s: async read already in progress.", caller);
+        dhtRecordResult(pDht, DHT_BUSY);
+        return DHT_BUSY;
+    }
+
+    if (!dhtReadIntervalElapsed(pDht)) {
+        if (dhtReadFromCache(pDht, pRaw)) {
+            return DHT_OK;
+        }
+
+        dhtEventRecord(pDht->pin, DHT_READ_QUERY_TOO_FREQUENT, DHT_PHASE_START, __LINE__, 0, 0, pDht->pc);
+        dhtRecordResult(pDht, DHT_READ_QUERY_TOO_FREQUENT);
+        return DHT_READ_QUERY_TOO_FREQUENT;
+    }
+
+    dhtPowerPrepare(pDht);
+ 
+    // DHT22 frame: RH high, RH low, TEMP high, TEMP low, CHECKSUM
+    dht_result_t result;
+    uint32_t threshold = dhtBitThreshold(pDht);
+    memset(pRaw, 0, sizeof(dht_raw_t));
+
+    #if DHT_USE_ISR_CAPTURE == 1
+    result = dhtReadRawDataIsr(pDht, pRaw->frame, threshold);
+    #elif DHT_USE_DMA_CAPTURE == 1
+    result = dhtReadRawDataDma(pDht, pRaw->frame, threshold);
+    #else
+    result = dhtReadRawData(pDht, pRaw->frame, threshold);
+    #endif
+
+    if (result == DHT_OK) {
+        result = dhtValidateFrame(pDht->pin, pRaw->frame);
+    }
+
+    if (result == DHT_OK) {
+        pRaw->ticks = pDht->pc;
+        dhtCacheResult(pDht, pRaw->frame);
+    }
+
+    dhtRecordResult(pDht, result);
+    return result;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ * dhtReadAsync - Public method to start a read without blocking the caller.
+ *
+ * Inputs
+ *      pDht     - pointer to dht_t.
+ *      callback - called with the result once the frame is decoded. Runs in 
+ *                 the FreeRTOS timer task, so it must not block. If NULL the
+ *                 calling task is notified instead (notification value is 
+ *                 the dht_result_t) and picks up the data with 
+ *                 dhtGetAsyncResult.
+ *      arg      - passed through to callback.
+ *
+ * Returns dht_result_t for starting the read, DHT_OK means the completion
+ * will be delivered later.
+ *
+ * Notes
+ *      The start signal is timed by a one-shot FreeRTOS timer. With 
+ *      DHT_USE_ISR_CAPTURE the frame is then captured by the edge ISR and 
+ *      the timer only guards the timeout; otherwise the timer task polls 
+ *      the ~5ms frame itself, DHT_USE_DMA_CAPTURE included since the timer
+ *      task must not block on the I2S receiver. A switched sensor that is
+ *      off is powered up and settled first, in the caller.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+dht_result_t
+dhtReadAsync(dht_t *pDht, dht_callback_t callback, void *arg) {
+    if (pDht == NULL) {
+        ESP_LOGE(DHT_TAG, "DHT::readAsync: input 'dht' cannot be NULL.");
+        return DHT_INVALID_INPUT;
+    }
+
+    dhtpvt_t *pvt = (dhtpvt_t *)pDht->opaque;
+    if (pvt->asyncState != DHT_ASYNC_IDLE) {
+        ESP_LOGE(DHT_TAG, "DHT::readAsync: async read already in progress.");
+        dhtRecordResult(pDht, DHT_BUSY);
+        return DHT_BUSY;
+    }
+
+    dht_result_t result = dhtCheckReadInterval(pDht);
+    if (result != DHT_OK) {
+        dhtRecordResult(pDht, result);
+        return result;
+    }
+
+    // blocks only for a switched sensor that was not powered up ahead
+    dhtPowerPrepare(pDht);
+
+    if (pvt->asyncTimer == NULL) {
+        pvt->asyncTimer = xTimerCreate("dhtAsync", DHT_START_SIGNAL_TICKS, pdFALSE, pDht, dhtAsyncTimerCallback);
+        if (pvt->asyncTimer == NULL) {
+            ESP_LOGE(DHT_TAG, "DHT::readAsync: Failed to create timer. (%d)", __LINE__);
+            return DHT_TIMER_FAILED;
+        }
+    }
+
+    pvt->asyncCallback = callback;
+    pvt->asyncArg = arg;
+    pvt->asyncTask = callback == NULL ? xTaskGetCurrentTaskHandle() : NULL;
+    pvt->asyncResult = DHT_BUSY;
+
+    result = dhtSendStartSignal(pDht);
+    if (result != DHT_OK) {
+        dhtRecordResult(pDht, result);
+        return result;
+    }
+
+    pvt->asyncState = DHT_ASYNC_START_SIGNAL;
+    if (xTimerChangePeriod(pvt->asyncTimer, DHT_START_SIGNAL_TICKS, 0) != pdPASS) {
+        ESP_LOGE(DHT_TAG, "DHT::readAsync: Failed to start timer. (%d)", __LINE__);
+        pvt->asyncState = DHT_ASYNC_IDLE;
+        gpio_set_direction(pDht->pin, GPIO_MODE_INPUT);
+        dhtRecordResult(pDht, DHT_TIMER_FAILED);
+        return DHT_TIMER_FAILED;
+    }
+
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ * dhtGetAsyncResult - Public method to fetch the outcome of the last 
+ *                     dhtReadAsync.
+ *
+ * Returns dht_result_t of the read, DHT_BUSY while it is still in progress.
+ * outdata is only written when the read succeeded.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+dht_result_t
+dhtGetAsyncResult(dht_t *pDht, dht_data_t *outdata) {
+    if (pDht == NULL || outdata == NULL) {
+        ESP_LOGE(DHT_TAG, "DHT::getAsyncResult: inputs cannot be NULL.");
+        return DHT_INVALID_INPUT;
+    }
+
+    dhtpvt_t *pvt = (dhtpvt_t *)pDht->opaque;
+    if (pvt->asyncState != DHT_ASYNC_IDLE) {
+        return DHT_BUSY;
+    }
+
+    if (pvt->asyncResult == DHT_OK) {
+        *outdata = pvt->asyncData;
+    }
+
+    return pvt->asyncResult;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ * dhtGetStats - Public method to snapshot the sensor's read statistics.
+ *
+ * Inputs
+ *      pDht  - pointer to dht_t.
+ *      stats - receives counters and per-phase latency.
+ *
+ * Returns dht_result_t.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+dht_result_t
+dhtGetStats(dht_t *pDht, dht_stats_t *stats) {
+    if (pDht == NULL || stats == NULL) {
+        ESP_LOGE(DHT_TAG, "DHT::getStats: inputs cannot be NULL.");
+        return DHT_INVALID_INPUT;
+    }
+
+    dhtpvt_t *pvt = (dhtpvt_t *)pDht->opaque;
+    stats->successCount = pvt->successCount;
+    stats->errorCount = pvt->errorCount;
+    stats->cacheHits = pvt->cacheHits;
+    memcpy(stats->results, pvt->results, sizeof(stats->results));
+    stats->jitterLastUs = pvt->jitterLastUs;
+    stats->jitterMaxUs = pvt->jitterMaxUs;
+    stats->maskedMaxUs = pvt->maskedMaxUs;
+    stats->bitThresholdUs = pvt->bitThresholdUs;
+    stats->powerSettleMs = pvt->powerSwitched ? pvt->powerSettleMs : 0;
+    stats->powerCycles = pvt->powerCycles;
+
+    for (int x=0; x<DHT_PHASE_MAX; x++) {
+        stats->latency[x] = pvt->latency[x];
+        stats->latency[x].avgUs = pvt->latency[x].count > 0 ? (uint32_t)(pvt->latencySumUs[x] / pvt->latency[x].count) : 0;
+    }
+
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ * dhtResetStats - Public method to zero the sensor's read statistics.
+ *
+ * Returns dht_result_t.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+dht_result_t
+dhtResetStats(dht_t *pDht) {
+    if (pDht == NULL) {
+        ESP_LOGE(DHT_TAG, "DHT::resetStats: input 'dht' cannot be NULL.");
+        return DHT_INVALID_INPUT;
+    }
+
+    dhtClearStats(pDht->opaque);
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ * dhtTicksUntilReady - Public method, ticks before the sensor's minimum read
+ *                      interval since the last start signal has passed.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+TickType_t
+dhtTicksUntilReady(dht_t *pDht) {
+    int32_t wait = (int32_t)(pDht->pc + pdMS_TO_TICKS(DHT_MIN_READ_INTERVAL) - xTaskGetTickCount());
+    return wait > 0 ? (TickType_t)wait : 0;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ * dhtSetPower - Public method to hand the sensor's supply switch to the driver.
+ *
+ * Inputs
+ *      pDht   - pointer to dht_t, no async read in progress.
+ *      pPower - switch pin and polarity, copied.
+ *
+ * Returns dht_result_t.
+ *
+ * Notes
+ *      A gated sensor is switched off right away. One that stays on is
+ *      treated as just powered, so its first read still waits the settle
+ *      time. The settle time starts at DHT_POWER_SETTLE_MS.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+dht_result_t
+dhtSetPower(dht_t *pDht, const dht_power_t *pPower) {
+    if (pDht == NULL || pPower == NULL) {
+        ESP_LOGE(DHT_TAG, "DHT::setPower: inputs cannot be NULL.");
+        return DHT_INVALID_INPUT;
+    }
+
+    if (!GPIO_IS_VALID_GPIO(pPower->pin) || pPower->pin == pDht->pin) {
+        ESP_LOGE(DHT_TAG, "DHT::setPower: Pin '%d' is not valid or is the DATA pin! (%d)", pPower->pin, __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    dhtpvt_t *pvt = (dhtpvt_t *)pDht->opaque;
+    if (pvt->asyncState != DHT_ASYNC_IDLE) {
+        ESP_LOGE(DHT_TAG, "DHT::setPower: async read in progress. (%d)", __LINE__);
+        return DHT_BUSY;
+    }
+
+    if (gpio_set_direction(pPower->pin, GPIO_MODE_OUTPUT) != ESP_OK) {
+        ESP_LOGE(DHT_TAG, "DHT::setPower: Failed to set pin '%d' to OUTPUT. (%d)", pPower->pin, __LINE__);
+        return DHT_FAILED_TO_SET_PIN_DIRECTION;
+    }
+
+    pvt->power = *pPower;
+    pvt->powerSwitched = true;
+    pvt->powerSettleMs = DHT_POWER_SETTLE_MS;
+    pvt->powerFailMs = 0;
+    pvt->noResponseRun = 0;
+    dhtPowerSwitch(pDht, !pPower->gate);
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ * dhtPowerUp - Public method to switch a sensor on ahead of its read.
+ *
+ * Returns dht_result_t.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+dht_result_t
+dhtPowerUp(dht_t *pDht) {
+    if (pDht == NULL) {
+        ESP_LOGE(DHT_TAG, "DHT::powerUp: input 'dht' cannot be NULL.");
+        return DHT_INVALID_INPUT;
+    }
+
+    dhtpvt_t *pvt = (dhtpvt_t *)pDht->opaque;
+    if (pvt->powerSwitched && !pvt->powered) {
+        dhtPowerSwitch(pDht, true);
+    }
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ * dhtPowerLeadTicks - Public method, how long before its read a switched
+ *                     sensor has to be powered up.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+TickType_t
+dhtPowerLeadTicks(dht_t *pDht) {
+    dhtpvt_t *pvt = (dhtpvt_t *)pDht->opaque;
+    return (pvt->powerSwitched && !pvt->powered) ? pdMS_TO_TICKS(pvt->powerSettleMs) : 0;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ * dhtSaveState - Public method to snapshot state that should survive a sleep.
+ *
+ * Inputs
+ *      pDht  - pointer to dht_t.
+ *      state - receives the pin, calibration and age of the last read.
+ *
+ * Returns dht_result_t.
+ *
+ * Notes
+ *      The tick count restarts on every wake, so the last read is stored as
+ *      an age, which dhtRestoreState advances by the wall-clock time that
+ *      passed in between.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+dht_result_t
+dhtSaveState(dht_t *pDht, dht_state_t *state) {
+    if (pDht == NULL || state == NULL) {
+        ESP_LOGE(DHT_TAG, "DHT::saveState: inputs cannot be NULL.");
+        return DHT_INVALID_INPUT;
+    }
+
+    dhtpvt_t *pvt = (dhtpvt_t *)pDht->opaque;
+    memset(state, 0, sizeof(dht_state_t));
+    state->pin = pDht->pin;
+    state->bitThresholdUs = pvt->bitThresholdUs;
+
+    // pc is only set by a start signal, 0 means this boot never read
+    state->lastReadAgeMs = pDht->pc == 0 ? DHT_STATE_NEVER_READ : (xTaskGetTickCount() - pDht->pc) * portTICK_PERIOD_MS;
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ * dhtRestoreState - Public method to resume from a saved state.
+ *
+ * Inputs
+ *      pDht      - pointer to dht_t, freshly initialized.
+ *      state     - from dhtSaveState before the sleep.
+ *      elapsedMs - wall-clock time since dhtSaveState.
+ *
+ * Returns dht_result_t, DHT_INVALID_INPUT if the state is for another pin.
+ *
+ * Notes
+ *      Only valid if the sensor stayed powered, a power cycle needs the
+ *      full power-up wait whatever the state says.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+dht_result_t
+dhtRestoreState(dht_t *pDht, const dht_state_t *state, uint32_t elapsedMs) {
+    if (pDht == NULL || state == NULL || state->pin != pDht->pin) {
+        ESP_LOGE(DHT_TAG, "DHT::restoreState: inputs cannot be NULL and the state must be for this pin. (%d)", __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    dhtpvt_t *pvt = (dhtpvt_t *)pDht->opaque;
+    if (state->bitThresholdUs > 0) {
+        pvt->bitThresholdUs = state->bitThresholdUs;
+    }
+
+    if (state->lastReadAgeMs == DHT_STATE_NEVER_READ) {
+        return DHT_OK;
+    }
+
+    // clamped at the read interval, an older read makes no difference and
+    // keeps pc within signed tick range
+    uint32_t ageMs = state->lastReadAgeMs + elapsedMs;
+    if (ageMs < state->lastReadAgeMs || ageMs > DHT_MIN_READ_INTERVAL) {
+        ageMs = DHT_MIN_READ_INTERVAL;
+    }
+    pDht->pc = xTaskGetTickCount() - pdMS_TO_TICKS(ageMs);
+
+    #if DEBUG == 1
+    ESP_LOGI(DHT_TAG, "DHT::restoreState: '%s' last read %dms ago, threshold %dus (%d)", pDht->name, ageMs, pvt->bitThresholdUs, __LINE__);
+    #endif
+    return DHT_OK;
+}
+
+#if DHT_USE_FAST_GPIO == 1
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ * dhtReadMulti - Public method to read several sensors in a single capture.
+ *
+ * Inputs
+ *      ppDht   - array of sensors, all on GPIO0-15 and on distinct pins.
+ *      count   - number of sensors, at most DHT_MULTI_MAX_SENSORS.
+ *      outdata - array of count dht_data_t, written for sensors that read OK.
+ *      results - array of count dht_result_t, per-sensor outcome.
+ *
+ * Returns dht_result_t, DHT_OK if the capture ran (see results for each 
+ * sensor).
+ *
+ * Notes
+ *      All start signals are sent together, the lines are released with 
+ *      one GPIO_ENABLE write and the whole GPIO_IN register is sampled in 
+ *      one loop. Edges are demultiplexed per pin into separate frames, so
+ *      the batch takes about as long as one dhtReadRawData. Each frame is 
+ *      then validated by dhtProcessRawData on its own.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+dht_result_t
+dhtReadMulti(dht_t **ppDht, uint8_t count, dht_data_t *outdata, dht_result_t *results) {
+    if (ppDht == NULL || outdata == NULL || results == NULL || count == 0 || count > DHT_MULTI_MAX_SENSORS) {
+        ESP_LOGE(DHT_TAG, "DHT::readMulti: invalid input, count=%d. (%d)", count, __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    // validate the whole batch before any sensor is powered or any pin driven
+    uint32_t mask = 0;
+    for (int x=0; x<count; x++) {
+        if (ppDht[x] == NULL || ppDht[x]->pin > 15 || (mask & (1 << ppDht[x]->pin))) {
+            ESP_LOGE(DHT_TAG, "DHT::readMulti: sensor %d is NULL, above GPIO15 or shares a pin. (%d)", x, __LINE__);
+            return DHT_INVALID_INPUT;
+        }
+        mask |= 1 << ppDht[x]->pin;
+    }
+
+    uint8_t  pins[DHT_MULTI_MAX_SENSORS];
+    uint8_t  slot[DHT_MULTI_MAX_SENSORS];      // capture slot -> index into ppDht
+    uint8_t  active = 0;
+    mask = 0;
+
+    // switched sensors settle together, not one after the other
+    TickType_t settle = 0;
+    for (int x=0; x<count; x++) {
+        if (dhtReadIntervalElapsed(ppDht[x])) {
+            TickType_t lead = dhtPowerLeadTicks(ppDht[x]);
+            settle = lead > settle ? lead : settle;
+            dhtPowerUp(ppDht[x]);
+        }
+    }
+    if (settle > 0) {
+        vTaskDelay(settle);
+    }
+
+    for (int x=0; x<count; x++) {
+        if (((dhtpvt_t *)ppDht[x]->opaque)->asyncState != DHT_ASYNC_IDLE) {
+            results[x] = DHT_BUSY;
+            dhtRecordResult(ppDht[x], DHT_BUSY);
+            continue;
+        }
+
+        if (!dhtReadIntervalElapsed(ppDht[x])) {
+            dht_raw_t raw;
+            if (dhtReadFromCache(ppDht[x], &raw)) {
+                dhtDecodeRaw(&raw, &outdata[x]);
+                results[x] = DHT_OK;
+            } else {
+                results[x] = DHT_READ_QUERY_TOO_FREQUENT;
+                dhtRecordResult(ppDht[x], DHT_READ_QUERY_TOO_FREQUENT);
+            }
+            continue;
+        }
+
+        dhtPowerPrepare(ppDht[x]);
+        if ((results[x] = dhtSendStartSignal(ppDht[x])) != DHT_OK) {
+            gpio_set_direction(ppDht[x]->pin, GPIO_MODE_INPUT);
+            dhtRecordResult(ppDht[x], results[x]);
+            continue;
+        }
+
+        pins[active] = ppDht[x]->pin;
+        slot[active] = (uint8_t)x;
+        mask |= 1 << ppDht[x]->pin;
+        active++;
+    }
+
+    if (active == 0) {
+        return DHT_OK;
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(BEGIN_READ_CYCLE_LOW));
+
+    uint8_t frames[DHT_MULTI_MAX_SENSORS][DHT_FRAME_SIZE];
+    uint8_t pulses[DHT_MULTI_MAX_SENSORS];
+    uint8_t lastLevel[DHT_MULTI_MAX_SENSORS];
+    uint32_t thresholds[DHT_MULTI_MAX_SENSORS];
+    memset(frames, 0, sizeof(frames));
+    for (int x=0; x<active; x++) {
+        thresholds[x] = dhtBitThreshold(ppDht[slot[x]]);
+    }
+
+    // START time-sensitive code.
+    // drive all lines HIGH together, then hand them to the pull-ups at once
+    GPIO_REG_WRITE(GPIO_OUT_W1TS_ADDRESS, mask);
+    ets_delay_us(BEGIN_READ_CYCLE_HIGH);
+    GPIO_REG_WRITE(GPIO_ENABLE_W1TC_ADDRESS, mask);
+    uint32_t released = dhtGetCycleCount();
+
+    // one shared sampling loop, each slot calibrates against its own sensor's response
+    uint32_t mhz = ets_get_cpu_frequency();
+    uint32_t maxGap, masked;
+    dhtCaptureMulti(pins, active, frames, pulses, lastLevel, thresholds, mhz, &maxGap, &masked);
+    // END time-sensitive code. 
+
+    // the shared loop does not split per-sensor phases, only start and total are timed
+    for (int x=0; x<active; x++) {
+        dhttiming_t *pTiming = &((dhtpvt_t *)ppDht[slot[x]]->opaque)->timing;
+        dhtMarkPhase(pTiming, DHT_PHASE_START, released - pTiming->start);
+        dhtRecordJitter(ppDht[slot[x]], maxGap, masked, mhz);
+    }
+
+    // keep the driver's view of the pins in sync with the register writes
+    for (int x=0; x<active; x++) {
+        gpio_set_direction(pins[x], GPIO_MODE_INPUT);
+    }
+
+    for (int x=0; x<active; x++) {
+        dht_t *pDht = ppDht[slot[x]];
+        if (pulses[x] < DHT_MULTI_PULSES) {
+            results[slot[x]] = lastLevel[x] == DHT_LOW ? DHT_SENSOR_DID_NOT_SWITCH_TO_HIGH : DHT_SENSOR_DID_NOT_SWITCH_TO_LOW;
+            dhtEventRecord(pDht->pin, results[slot[x]], DHT_PHASE_PAYLOAD, __LINE__, pulses[x], pulses[x], 0);
+            dhtRecordResult(pDht, results[slot[x]]);
+            continue;
+        }
+
+        dhtNoteThreshold(pDht, thresholds[x], mhz);
+        results[slot[x]] = dhtProcessRawData(pDht->pin, frames[x], &outdata[slot[x]]);
+        if (results[slot[x]] == DHT_OK) {
+            dhtCacheResult(pDht, frames[x]);
+        }
+        dhtRecordResult(pDht, results[slot[x]]);
+    }
+
+    return DHT_OK;
+}
+#endif
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtReadIntervalElapsed - Private method, true once DHT_MIN_READ_INTERVAL 
+ *                           has passed since the last start signal (pc).
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static bool
+dhtReadIntervalElapsed(dht_t *pDht) {
+    return (xTaskGetTickCount() - pDht->pc) >= pdMS_TO_TICKS(DHT_MIN_READ_INTERVAL);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtCheckReadInterval - Private method to enforce the sensor's minimum 
+ *                         interval between reads.
+ *
+ *  Returns DHT_OK if a new read may start.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static dht_result_t
+dhtCheckReadInterval(dht_t *pDht) {
+    if (!dhtReadIntervalElapsed(pDht)) {
+        dhtEventRecord(pDht->pin, DHT_READ_QUERY_TOO_FREQUENT, DHT_PHASE_START, __LINE__, 0, 0, pDht->pc);
+        return DHT_READ_QUERY_TOO_FREQUENT;
+    }
+
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtReadFromCache - Private method to return the last valid reading.
+ *
+ *  Returns false if the sensor has not produced a valid reading yet.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static bool
+dhtReadFromCache(dht_t *pDht, dht_raw_t *pRaw) {
+    dhtpvt_t *pvt = (dhtpvt_t *)pDht->opaque;
+    if (!pvt->hasLastGood) {
+        return false;
+    }
+
+    pvt->cacheHits++;
+    memcpy(pRaw->frame, pvt->lastGood, DHT_FRAME_SIZE);
+    pRaw->ticks = pvt->lastGoodTicks;
+    pRaw->fromCache = true;
+    pRaw->ageMs = (xTaskGetTickCount() - pvt->lastGoodTicks) * portTICK_PERIOD_MS;
+    return true;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtCacheResult - Private method to remember a fresh valid frame, time 
+ *                   stamped with the start signal that produced it.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static void
+dhtCacheResult(dht_t *pDht, const uint8_t *frame) {
+    dhtpvt_t *pvt = (dhtpvt_t *)pDht->opaque;
+    memcpy(pvt->lastGood, frame, DHT_FRAME_SIZE);
+    pvt->lastGoodTicks = pDht->pc;
+    pvt->hasLastGood = true;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtClearStats - Private method to zero the counters and latency of a 
+ *                  dhtpvt_t and set each phase's histogram bucket width.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static void
+dhtClearStats(void *opaque) {
+    dhtpvt_t *pvt = (dhtpvt_t *)opaque;
+
+    pvt->successCount = 0;
+    pvt->errorCount = 0;
+    pvt->cacheHits = 0;
+    memset(pvt->results, 0, sizeof(pvt->results));
+    memset(pvt->latency, 0, sizeof(pvt->latency));
+    memset(pvt->latencySumUs, 0, sizeof(pvt->latencySumUs));
+    pvt->jitterLastUs = 0;
+    pvt->jitterMaxUs = 0;
+    pvt->maskedMaxUs = 0;
+    pvt->powerCycles = 0;
+
+    for (int x=0; x<DHT_PHASE_MAX; x++) {
+        pvt->latency[x].bucketUs = gPhaseNominalUs[x] / 4;
+    }
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtRecordJitter - Private method to fold a polled capture's worst sample
+ *                    gap and masked time, both in cycles, into the stats.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static void
+dhtRecordJitter(dht_t *pDht, uint32_t maxGap, uint32_t masked, uint32_t mhz) {
+    dhtpvt_t *pvt = (dhtpvt_t *)pDht->opaque;
+
+    pvt->jitterLastUs = maxGap / mhz;
+    if (pvt->jitterLastUs > pvt->jitterMaxUs) {
+        pvt->jitterMaxUs = pvt->jitterLastUs;
+    }
+    if (masked / mhz > pvt->maskedMaxUs) {
+        pvt->maskedMaxUs = masked / mhz;
+    }
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtNoteThreshold - Private method to remember the threshold, in cycles, a
+ *                     complete capture was decoded with; dhtRecordResult
+ *                     learns it if the frame turns out valid.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static void
+dhtNoteThreshold(dht_t *pDht, uint32_t threshold, uint32_t mhz) {
+    uint32_t us = (threshold + mhz / 2) / mhz;
+    ((dhtpvt_t *)pDht->opaque)->frameThresholdUs = (uint8_t)(us > 0xff ? 0xff : us);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtPowerSwitch - Private method to drive the supply switch. DATA is held
+ *                   LOW while the sensor is off and released on power-up.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static void
+dhtPowerSwitch(dht_t *pDht, bool on) {
+    dhtpvt_t *pvt = (dhtpvt_t *)pDht->opaque;
+    uint32_t level = on == pvt->power.activeHigh ? DHT_HIGH : DHT_LOW;
+
+    if (!on) {
+        gpio_set_direction(pDht->pin, GPIO_MODE_OUTPUT);
+        gpio_set_level(pDht->pin, DHT_LOW);
+    }
+
+    gpio_set_level(pvt->power.pin, level);
+
+    if (on) {
+        gpio_set_direction(pDht->pin, GPIO_MODE_INPUT);
+        pvt->powerOnTicks = xTaskGetTickCount();
+        pvt->powerFresh = true;
+    }
+    pvt->powered = on;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtPowerPrepare - Private method run before a capture: powers a switched
+ *                    sensor up if needed and waits out the rest of its 
+ *                    settle time.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static void
+dhtPowerPrepare(dht_t *pDht) {
+    dhtpvt_t *pvt = (dhtpvt_t *)pDht->opaque;
+    if (!pvt->powerSwitched) {
+        return;
+    }
+
+    if (!pvt->powered) {
+        dhtPowerSwitch(pDht, true);
+    }
+
+    if (pvt->powerFresh) {
+        int32_t wait = (int32_t)(pvt->powerOnTicks + pdMS_TO_TICKS(pvt->powerSettleMs) - xTaskGetTickCount());
+        if (wait > 0) {
+            vTaskDelay((TickType_t)wait);
+        }
+    }
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtPowerAfterRead - Private method run with every read outcome: learns 
+ *                      the settle time from the first capture after power-up,
+ *                      power-cycles a sensor that keeps not answering and
+ *                      powers a gated one down.
+ *
+ *  Notes
+ *      Outcomes that never sent a start signal (busy, too frequent) leave
+ *      the power alone. A power cycle only switches the sensor off; it is
+ *      off for at least DHT_MIN_READ_INTERVAL, since that is the earliest
+ *      next read, which powers it up again.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static void
+dhtPowerAfterRead(dht_t *pDht, dht_result_t result) {
+    dhtpvt_t *pvt = (dhtpvt_t *)pDht->opaque;
+    if (!pvt->powerSwitched || !pvt->powered || result == DHT_BUSY || result == DHT_READ_QUERY_TOO_FREQUENT ||
+        result == DHT_INVALID_INPUT || result == DHT_MALLOC_FAILED) {
+        return;
+    }
+
+    bool noResponse = result == DHT_SENSOR_DID_NOT_SWITCH_TO_HIGH || result == DHT_SENSOR_DID_NOT_SWITCH_TO_LOW;
+    if (pvt->powerFresh && (result == DHT_OK || noResponse)) {
+        dhtPowerLearn(pvt, (pDht->pc - pvt->powerOnTicks) * portTICK_PERIOD_MS, result == DHT_OK);
+    }
+    pvt->powerFresh = false;
+
+    pvt->noResponseRun = noResponse ? pvt->noResponseRun + 1 : 0;
+    if (pvt->noResponseRun >= DHT_POWER_CYCLE_FAILURES) {
+        ESP_LOGW(DHT_TAG, "DHT::read: '%s' did not answer %d reads in a row, power cycling. (%d)", 
+                    pDht->name, pvt->noResponseRun, __LINE__);
+        pvt->noResponseRun = 0;
+        pvt->powerCycles++;
+        dhtPowerSwitch(pDht, false);
+        return;
+    }
+
+    if (pvt->power.gate) {
+        dhtPowerSwitch(pDht, false);
+    }
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtPowerLearn - Private method to move the settle time after a read 
+ *                  'settledMs' past power-up answered or not.
+ *
+ *  Notes
+ *      An answer moves the wait a quarter of the way down towards the 
+ *      longest wait that failed, at least DHT_POWER_SETTLE_STEP_MS, so it
+ *      closes in on the sensor's real minimum. A miss raises that floor and
+ *      backs off halfway to DHT_POWER_SETTLE_MS.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static void
+dhtPowerLearn(dhtpvt_t *pvt, uint32_t settledMs, bool answered) {
+    uint32_t failMs = pvt->powerFailMs;
+    uint32_t settle;
+
+    if (answered) {
+        uint32_t step = settledMs > failMs ? (settledMs - failMs) / 4 : 0;
+        step = step < DHT_POWER_SETTLE_STEP_MS ? DHT_POWER_SETTLE_STEP_MS : step;
+        settle = settledMs > failMs + step ? settledMs - step : settledMs;
+    } else {
+        failMs = settledMs > failMs ? settledMs : failMs;
+        failMs = failMs < DHT_POWER_SETTLE_MS - DHT_POWER_SETTLE_STEP_MS ? failMs : DHT_POWER_SETTLE_MS - DHT_POWER_SETTLE_STEP_MS;
+        pvt->powerFailMs = (uint16_t)failMs;
+        settle = failMs + (DHT_POWER_SETTLE_MS - failMs) / 2;
+        settle = settle > failMs + DHT_POWER_SETTLE_STEP_MS ? settle : failMs + DHT_POWER_SETTLE_STEP_MS;
+    }
+
+    settle = settle < DHT_POWER_SETTLE_MIN_MS ? DHT_POWER_SETTLE_MIN_MS : settle;
+    settle = settle > DHT_POWER_SETTLE_MS ? DHT_POWER_SETTLE_MS : settle;
+    pvt->powerSettleMs = (uint16_t)settle;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtRecordResult - Private method to count the outcome of a read and, for a
+ *                    successful one, fold its phase timings into the stats.
+ *
+ *  Notes
+ *      Runs after the time-sensitive code, the timing struct is filled by
+ *      the capture path and only integer math touches preallocated fields.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static void
+dhtRecordResult(dht_t *pDht, dht_result_t result) {
+    dhtpvt_t *pvt = (dhtpvt_t *)pDht->opaque;
+
+    dhtPowerAfterRead(pDht, result);
+
+    pvt->results[result]++;
+    if (result != DHT_OK) {
+        pvt->errorCount++;
+        return;
+    }
+
+    pvt->successCount++;
+
+    // a valid checksum vouches for the capture's threshold, fold it into
+    // the learned one used when a frame's own response is unusable
+    if (pvt->frameThresholdUs != 0) {
+        pvt->bitThresholdUs = (uint8_t)((pvt->bitThresholdUs * 3 + pvt->frameThresholdUs + 2) >> 2);
+        pvt->frameThresholdUs = 0;
+    }
+
+    dhttiming_t *pTiming = &pvt->timing;
+    dhtMarkPhase(pTiming, DHT_PHASE_TOTAL, dhtGetCycleCount() - pTiming->start);
+
+    uint32_t mhz = ets_get_cpu_frequency();
+    for (int x=0; x<DHT_PHASE_MAX; x++) {
+        if (!(pTiming->measured & (1 << x))) {
+            continue;
+        }
+
+        dht_latency_t *pLat = &pvt->latency[x];
+        uint32_t us = pTiming->cycles[x] / mhz;
+        if (pLat->count == 0 || us < pLat->minUs) {
+            pLat->minUs = us;
+        }
+        if (us > pLat->maxUs) {
+            pLat->maxUs = us;
+        }
+
+        uint32_t bucket = pLat->bucketUs > 0 ? us / pLat->bucketUs : 0;
+        pLat->histogram[bucket < DHT_HIST_BUCKETS ? bucket : DHT_HIST_BUCKETS-1]++;
+        pvt->latencySumUs[x] += us;
+        pLat->count++;
+    }
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtReadRawData - Private method to read data from DHT bus.
+ *  
+ *  Inputs
+ *      pDht     : pointer to pin info
+ *      frame    : pointer to frame buffer (DHT_FRAME_SIZE bytes)
+ *      threshold: HIGH-phase width in cycles above which a bit reads as 1
+ *
+ *  Returns dht_result_t  
+ * 
+ *  Read bus line to get Temperature & Humidity data.
+ *
+ *  Notes 
+ *      Algo from DHT22 spec sheet:
+ *          1. Read interval should be greater than 2 seconds.
+ *          2. To begin read cycle:
+ *              a. MCU Pulls DATA LOW for 1-10ms   (start signal)
+ *              b. MCU Pulls DATA HIGH for 20-40us (wait for response)
+ *              c. DHT responds with 80us LOW
+ *              d. DHT responds with 80us HIGH
+ *              e. Response cycle
+ *                  i.   50us LOW
+ *                  ii.  1-bit DATA --> 26-28us = 0, 70us = 1 
+ *                  iii. repeat 40 times 
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+dht_result_t
+dhtReadRawData(dht_t *pDht, uint8_t *frame, uint32_t threshold) {
+    dht_result_t result = dhtSendStartSignal(pDht);
+    if (result != DHT_OK) {
+        return result;
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(BEGIN_READ_CYCLE_LOW));
+
+    return dhtPollFrame(pDht, frame, threshold);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtSendStartSignal - Private method to take the DATA line and pull it LOW,
+ *                       the caller waits BEGIN_READ_CYCLE_LOW before release.
+ *                       Records the capture tick in pDht->pc.
+ *
+ *  Returns dht_result_t
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static dht_result_t
+dhtSendStartSignal(dht_t *pDht) {
+    if (gpio_set_direction(pDht->pin, GPIO_MODE_OUTPUT) != ESP_OK) {
+        dhtEventRecord(pDht->pin, DHT_FAILED_TO_SET_PIN_DIRECTION, DHT_PHASE_START, __LINE__, 0, 0, 0);
+        return DHT_FAILED_TO_SET_PIN_DIRECTION;;
+    } 
+    
+    // send LOW signal to get DHT sensor's attention 
+    if (gpio_set_level(pDht->pin, DHT_LOW) != ESP_OK) {
+        dhtEventRecord(pDht->pin, DHT_FAILED_TO_SET_PIN_LEVEL, DHT_PHASE_START, __LINE__, 0, 0, 0);
+        return DHT_FAILED_TO_SET_PIN_LEVEL;
+    }
+
+    // capture tick, the sensor needs DHT_MIN_READ_INTERVAL from here whether or not the read succeeds
+    pDht->pc = xTaskGetTickCount();
+
+    dhttiming_t *pTiming = &((dhtpvt_t *)pDht->opaque)->timing;
+    pTiming->start = dhtGetCycleCount();
+    pTiming->measured = 0;
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtPollFrame - Private method to release the DATA line after the start
+ *                 signal and poll the sensor's response and 40 data bits.
+ *  
+ *  Inputs
+ *      pDht     : pointer to pin info
+ *      frame    : pointer to frame buffer (DHT_FRAME_SIZE bytes)
+ *      threshold: HIGH-phase width in cycles above which a bit reads as 1
+ *
+ *  Returns dht_result_t  
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static dht_result_t
+dhtPollFrame(dht_t *pDht, uint8_t *frame, uint32_t threshold) {
+    // START time-sensitive code.
+    // send HIGH signal to tell DHT sensor that MCU is ready to receive data
+    if (gpio_set_level(pDht->pin, DHT_HIGH) != ESP_OK) {
+        dhtEventRecord(pDht->pin, DHT_FAILED_TO_SET_PIN_LEVEL, DHT_PHASE_START, __LINE__, 0, 0, 0);
+        return DHT_FAILED_TO_SET_PIN_LEVEL;
+    }
+
+    ets_delay_us(BEGIN_READ_CYCLE_HIGH);
+
+    dhttiming_t *pTiming = &((dhtpvt_t *)pDht->opaque)->timing;
+    dhtMarkPhase(pTiming, DHT_PHASE_START, dhtGetCycleCount() - pTiming->start);
+
+    // DHT sensor should be in LOW state after this delay
+    // set port direction to input
+    if (gpio_set_direction(pDht->pin, GPIO_MODE_INPUT) != ESP_OK) {
+        dhtEventRecord(pDht->pin, DHT_FAILED_TO_SET_PIN_DIRECTION, DHT_PHASE_START, __LINE__, 0, 0, 0);
+        return DHT_FAILED_TO_SET_PIN_DIRECTION;
+    }
+
+    uint32_t  mhz = ets_get_cpu_frequency();
+    dhtpoll_t poll;
+    dht_result_t result = dhtCaptureBits(pDht->pin, frame, threshold, mhz, &poll);
+    // END time-sensitive code. 
+
+    // recorded for failures too, a preemption is the usual reason a bit times out
+    dhtRecordJitter(pDht, poll.maxGap, poll.masked, mhz);
+
+    if (result != DHT_OK) {
+        // bit stays -1 until the sensor's response is over
+        dhtEventRecord(pDht->pin, result, poll.bit < 0 ? DHT_PHASE_RESPONSE_LOW : DHT_PHASE_PAYLOAD, __LINE__, poll.bit, 0, poll.elapsed/mhz);
+        return result;
+    }
+
+    dhtNoteThreshold(pDht, poll.threshold, mhz);
+    dhtMarkPhase(pTiming, DHT_PHASE_RESPONSE_LOW, poll.phases[DHT_PHASE_RESPONSE_LOW]);
+    dhtMarkPhase(pTiming, DHT_PHASE_RESPONSE_HIGH, poll.phases[DHT_PHASE_RESPONSE_HIGH]);
+    dhtMarkPhase(pTiming, DHT_PHASE_PAYLOAD, poll.phases[DHT_PHASE_PAYLOAD]);
+
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtCaptureBits - Private IRAM-resident routine that polls the DHT response
+ *                   and the 40 data bits once the MCU has released the line.
+ *  
+ *  Inputs
+ *      pin     : GPIO pin connected to DATA
+ *      frame   : pointer to frame buffer (DHT_FRAME_SIZE bytes)
+ *      threshold: HIGH-phase width in cycles above which a bit reads as 1,
+ *                used when the response HIGH is out of bounds
+ *      mhz     : CPU clock in MHz, used to scale the protocol timeouts
+ *      pPoll   : receives failing bit and elapsed cycles, the worst sample
+ *                gap, masked cycles, the threshold used and, on DHT_OK, 
+ *                the phase timings
+ *
+ *  Returns dht_result_t  
+ *
+ *  Notes
+ *      Kept free of logging so failures are reported by the caller. With 
+ *      DHT_USE_FAST_GPIO=1 the hot loop reads GPIO_IN directly and runs 
+ *      entirely from IRAM with no flash cache misses; with 0 each sample is
+ *      a gpio_get_level call, which lives in flash. The response LOW is 
+ *      timed from line release, so it reads a little short.
+ *      With DHT_CRITICAL_CAPTURE interrupts are masked for the payload only,
+ *      the response phases still run preemptible.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static dht_result_t IRAM_ATTR
+dhtCaptureBits(uint8_t pin, uint8_t *frame, uint32_t threshold, uint32_t mhz, dhtpoll_t *pPoll) {
+    const uint32_t responseLowTimeout  = (BEGIN_READ_CYCLE_DHT_LOW + DHT_TIMEOUT_MARGIN_US) * mhz;
+    const uint32_t responseHighTimeout = (BEGIN_READ_CYCLE_DHT_HIGH + DHT_TIMEOUT_MARGIN_US) * mhz;
+    const uint32_t attentionTimeout    = (BEGIN_DATA_READ_DHT_ATTENTION + DHT_TIMEOUT_MARGIN_US) * mhz;
+    const uint32_t dataTimeout         = (BEGIN_DATA_RECEIVE_DHT_DATA + DHT_TIMEOUT_MARGIN_US) * mhz;
+    const uint32_t nominal             = DHT_BIT_THRESHOLD_US * mhz;
+    dht_result_t result = DHT_OK;
+    uint32_t elapsed;
+
+    pPoll->bit = -1;
+    pPoll->elapsed = 0;
+    pPoll->maxGap = 0;
+    pPoll->masked = 0;
+    pPoll->threshold = threshold;
+
+    // Wait for DHT sensor to ready itself to send info: 
+    // DHT sensor will stay LOW for 80us
+    elapsed = dhtMeasureLevel(pin, DHT_LOW, responseLowTimeout, &pPoll->maxGap);
+    if (elapsed > responseLowTimeout) {
+        pPoll->elapsed = elapsed;
+        return DHT_SENSOR_DID_NOT_SWITCH_TO_HIGH;
+    }
+    pPoll->phases[DHT_PHASE_RESPONSE_LOW] = elapsed;
+
+    // DHT sensor will stay HIGH for 80us
+    elapsed = dhtMeasureLevel(pin, DHT_HIGH, responseHighTimeout, &pPoll->maxGap);
+    if (elapsed > responseHighTimeout) {
+        pPoll->elapsed = elapsed;
+        return DHT_SENSOR_DID_NOT_SWITCH_TO_LOW;
+    }
+    pPoll->phases[DHT_PHASE_RESPONSE_HIGH] = elapsed;
+
+    // the 80us HIGH is the sensor's clock as seen down this cable, rescale the split to it
+    threshold = dhtResponseThreshold(elapsed, nominal, threshold);
+    pPoll->threshold = threshold;
+
+    // DHT sensor in LOW state, begin reading bits
+    #if DHT_CRITICAL_CAPTURE == 1
+    uint32_t ps = dhtMaskInterrupts();
+    #endif
+    uint32_t payloadStart = dhtGetCycleCount();
+    for (int x=0;x<40;x++) {
+        // Now begin receiving data, DHT sensor is in HIGH state
+        // 50us LOW followed by variable signal:
+        //      ~28us = HIGH 
+        //      ~70us = HIGH 
+        pPoll->bit = x;
+        elapsed = dhtMeasureLevel(pin, DHT_LOW, attentionTimeout, &pPoll->maxGap);
+        if (elapsed > attentionTimeout) {
+            result = DHT_SENSOR_DID_NOT_SWITCH_TO_HIGH;
+            break;
+        }
+ 
+        elapsed = dhtMeasureLevel(pin, DHT_HIGH, dataTimeout, &pPoll->maxGap);
+        if (elapsed > dataTimeout) {
+            result = DHT_SENSOR_DID_NOT_SWITCH_TO_LOW;
+            break;
+        }
+
+        // threshold the HIGH phase width and shift the bit in, MSB first
+        dhtDecodeBit(frame, x, elapsed, threshold);
+    }
+    uint32_t payloadCycles = dhtGetCycleCount() - payloadStart;
+    #if DHT_CRITICAL_CAPTURE == 1
+    dhtRestoreInterrupts(ps);
+    pPoll->masked = payloadCycles;
+    #endif
+
+    if (result != DHT_OK) {
+        pPoll->elapsed = elapsed;
+        return result;
+    }
+
+    pPoll->phases[DHT_PHASE_PAYLOAD] = payloadCycles;
+    return DHT_OK;
+}
+
+#if DHT_USE_FAST_GPIO == 1
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtCaptureMulti - Private IRAM-resident routine that samples GPIO_IN and 
+ *                    demultiplexes the frames of several sensors at once.
+ *  
+ *  Inputs
+ *      pins     : DATA pin of each capture slot
+ *      count    : number of slots in use
+ *      frames   : per-slot frame buffers, zeroed by the caller
+ *      pulses   : receives number of HIGH pulses seen per slot, a complete
+ *                 frame has DHT_MULTI_PULSES
+ *      lastLevel: receives line level of each slot when capture stopped
+ *      thresholds: per-slot HIGH-phase width in cycles above which a bit
+ *                 reads as 1; replaced by the one derived from the slot's
+ *                 response HIGH when that is in bounds
+ *      mhz      : CPU clock in MHz
+ *      pMaxGap  : receives longest gap between two GPIO_IN samples, cycles
+ *      pMasked  : receives cycles run with interrupts masked, 0 unless
+ *                 DHT_CRITICAL_CAPTURE
+ *
+ *  Notes
+ *      A slot whose line is still HIGH when sampling starts first sees the
+ *      tail of the MCU's release pulse, so its pulses count from 0; a slot 
+ *      already pulled LOW by the sensor starts at 1. Either way pulse 1 is
+ *      the 80us response and pulses 2..41 are the data bits.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static void IRAM_ATTR
+dhtCaptureMulti(const uint8_t *pins, uint8_t count, uint8_t (*frames)[DHT_FRAME_SIZE], uint8_t *pulses, 
+                uint8_t *lastLevel, uint32_t *thresholds, uint32_t mhz, uint32_t *pMaxGap, uint32_t *pMasked) {
+    uint32_t rise[DHT_MULTI_MAX_SENSORS];
+    uint32_t pinMask[DHT_MULTI_MAX_SENSORS];
+    uint32_t pending = 0;
+    uint32_t timeout = DHT_MULTI_FRAME_TIMEOUT * mhz;
+    uint32_t nominal = DHT_BIT_THRESHOLD_US * mhz;
+    uint32_t maxGap = 0;
+    #if DHT_CRITICAL_CAPTURE == 1
+    // the sensors answer at different times, so the whole frame is masked
+    uint32_t ps = dhtMaskInterrupts();
+    #endif
+    uint32_t start = dhtGetCycleCount();
+    uint32_t last = start;
+    uint32_t prev = GPIO_REG_READ(GPIO_IN_ADDRESS);
+
+    for (int x=0; x<count; x++) {
+        pinMask[x] = 1 << pins[x];
+        rise[x] = start;
+        pulses[x] = (prev & pinMask[x]) ? 0 : 1;
+        pending |= 1 << x;
+    }
+
+    while (pending) {
+        uint32_t now = dhtGetCycleCount();
+        uint32_t in = GPIO_REG_READ(GPIO_IN_ADDRESS);
+        uint32_t changed = in ^ prev;
+
+        if (now - last > maxGap) {
+            maxGap = now - last;
+        }
+        last = now;
+
+        if (changed) {
+            for (int x=0; x<count; x++) {
+                if (!(changed & pinMask[x]) || !(pending & (1 << x))) {
+                    continue;
+                }
+
+                if (in & pinMask[x]) {
+                    rise[x] = now;
+                    continue;
+                }
+
+                // falling edge ends a HIGH pulse
+                int bit = pulses[x] - 2;
+                if (bit >= 0) {
+                    dhtDecodeBit(frames[x], bit, now - rise[x], thresholds[x]);
+                } else if (bit == -1) {
+                    thresholds[x] = dhtResponseThreshold(now - rise[x], nominal, thresholds[x]);
+                }
+
+                if (++pulses[x] == DHT_MULTI_PULSES) {
+                    pending &= ~(1 << x);
+                }
+            }
+            prev = in;
+        }
+
+        if ((now - start) > timeout) {
+            break;
+        }
+    }
+
+    #if DHT_CRITICAL_CAPTURE == 1
+    *pMasked = dhtGetCycleCount() - start;
+    dhtRestoreInterrupts(ps);
+    #else
+    *pMasked = 0;
+    #endif
+    *pMaxGap = maxGap;
+
+    for (int x=0; x<count; x++) {
+        lastLevel[x] = (prev & pinMask[x]) ? DHT_HIGH : DHT_LOW;
+    }
+}
+#endif
+
+#if DHT_USE_ISR_CAPTURE == 1
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtEdgeIsr - Private GPIO ISR, timestamps every edge on the DATA line.
+ *  
+ *  Inputs
+ *      arg: pointer to dhtcapture_t of the sensor being read
+ *
+ *  Notes
+ *      Only level changes are recorded so a bouncing edge occupies one slot.
+ *      The waiting task is notified (or, for dhtReadAsync, the decode is 
+ *      pended to the timer task) once the falling edge ending the 40th bit
+ *      arrives or the edge buffer is full.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static void IRAM_ATTR 
+dhtEdgeIsr(void *arg) {
+    dhtcapture_t *pCap = (dhtcapture_t *)arg;
+    uint32_t now = dhtGetCycleCount();
+    uint8_t level = (uint8_t)DHT_READ_PIN(pCap->pin);
+    uint8_t count = pCap->edgeCount;
+
+    if (count >= DHT_MAX_EDGES || (count > 0 && pCap->level[count-1] == level)) {
+        return;
+    }
+
+    pCap->ccount[count] = now;
+    pCap->level[count]  = level;
+    pCap->edgeCount     = ++count;
+
+    if (level == DHT_LOW) {
+        pCap->fallingCount++;
+    }
+
+    if (pCap->fallingCount == DHT_RESPONSE_FALLING_EDGES || count == DHT_MAX_EDGES) {
+        BaseType_t woken = pdFALSE;
+        if (pCap->waiter != NULL) {
+            vTaskNotifyGiveFromISR(pCap->waiter, &woken);
+            pCap->waiter = NULL;
+        } else if (pCap->owner != NULL) {
+            xTimerPendFunctionCallFromISR(dhtAsyncCaptureDone, pCap->owner, 0, &woken);
+            pCap->owner = NULL;
+        }
+
+        if (woken == pdTRUE) {
+            portYIELD_FROM_ISR();
+        }
+    }
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtReadRawDataIsr - Private method to read data from DHT bus by capturing
+ *                      edges from a GPIO ISR instead of polling.
+ *  
+ *  Inputs
+ *      pDht     : pointer to pin info
+ *      frame    : pointer to frame buffer (DHT_FRAME_SIZE bytes)
+ *      threshold: HIGH-phase width in cycles above which a bit reads as 1
+ *
+ *  Returns dht_result_t  
+ * 
+ *  Notes 
+ *      Same start sequence as dhtReadRawData. Once the ISR is armed the
+ *      calling task blocks on a task notification for the rest of the
+ *      frame. Decoding pairs every rising edge with the next falling edge;
+ *      the last 40 HIGH pulses are the data bits, the one before them is 
+ *      the sensor's 80us response.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+dht_result_t
+dhtReadRawDataIsr(dht_t *pDht, uint8_t *frame, uint32_t threshold) {
+    dht_result_t result = dhtSendStartSignal(pDht);
+    if (result != DHT_OK) {
+        return result;
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(BEGIN_READ_CYCLE_LOW));
+
+    ulTaskNotifyTake(pdTRUE, 0);     // drop any stale notification
+    result = dhtIsrBeginCapture(pDht, xTaskGetCurrentTaskHandle());
+    if (result != DHT_OK) {
+        return result;
+    }
+
+    // block until the ISR reports a full frame, or give up after the timeout
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DHT_ISR_CAPTURE_TIMEOUT));
+
+    return dhtIsrEndCapture(pDht, frame, threshold);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtIsrBeginCapture - Private method to arm the edge ISR and release the 
+ *                       DATA line at the end of the start signal.
+ *  
+ *  Inputs
+ *      pDht  : pointer to pin info
+ *      waiter: task to notify when the frame is complete, NULL to pend 
+ *              dhtAsyncCaptureDone to the timer task instead
+ *
+ *  Returns dht_result_t, the ISR is disarmed again on failure.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static dht_result_t
+dhtIsrBeginCapture(dht_t *pDht, TaskHandle_t waiter) {
+    dhtcapture_t *pCap = &((dhtpvt_t *)pDht->opaque)->capture;
+
+    // arm the ISR before releasing the line so the response is not missed
+    pCap->edgeCount = 0;
+    pCap->fallingCount = 0;
+    pCap->waiter = waiter;
+    pCap->owner = waiter == NULL ? (void *)pDht : NULL;
+
+    if (gpio_isr_handler_add(pDht->pin, dhtEdgeIsr, pCap) != ESP_OK ||
+        gpio_set_intr_type(pDht->pin, GPIO_INTR_ANYEDGE) != ESP_OK) {
+        dhtEventRecord(pDht->pin, DHT_FAILED_TO_SET_PIN_MODE, DHT_PHASE_START, __LINE__, 0, 0, 0);
+        gpio_isr_handler_remove(pDht->pin);
+        return DHT_FAILED_TO_SET_PIN_MODE;
+    }
+
+    // START time-sensitive code.
+    // send HIGH signal to tell DHT sensor that MCU is ready to receive data
+    if (gpio_set_level(pDht->pin, DHT_HIGH) != ESP_OK) {
+        dhtEventRecord(pDht->pin, DHT_FAILED_TO_SET_PIN_LEVEL, DHT_PHASE_START, __LINE__, 0, 0, 0);
+        gpio_set_intr_type(pDht->pin, GPIO_INTR_DISABLE);
+        gpio_isr_handler_remove(pDht->pin);
+        return DHT_FAILED_TO_SET_PIN_LEVEL;
+    }
+
+    ets_delay_us(BEGIN_READ_CYCLE_HIGH);
+
+    dhttiming_t *pTiming = &((dhtpvt_t *)pDht->opaque)->timing;
+    dhtMarkPhase(pTiming, DHT_PHASE_START, dhtGetCycleCount() - pTiming->start);
+
+    if (gpio_set_direction(pDht->pin, GPIO_MODE_INPUT) != ESP_OK) {
+        dhtEventRecord(pDht->pin, DHT_FAILED_TO_SET_PIN_DIRECTION, DHT_PHASE_START, __LINE__, 0, 0, 0);
+        gpio_set_intr_type(pDht->pin, GPIO_INTR_DISABLE);
+        gpio_isr_handler_remove(pDht->pin);
+        return DHT_FAILED_TO_SET_PIN_DIRECTION;
+    }
+
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtIsrEndCapture - Private method to disarm the edge ISR and decode the
+ *                     captured edges into a frame.
+ *  
+ *  Inputs
+ *      pDht     : pointer to pin info
+ *      frame    : pointer to frame buffer (DHT_FRAME_SIZE bytes)
+ *      threshold: HIGH-phase width in cycles above which a bit reads as 1
+ *
+ *  Returns dht_result_t  
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static dht_result_t
+dhtIsrEndCapture(dht_t *pDht, uint8_t *frame, uint32_t threshold) {
+    dhtcapture_t *pCap = &((dhtpvt_t *)pDht->opaque)->capture;
+
+    gpio_set_intr_type(pDht->pin, GPIO_INTR_DISABLE);
+    gpio_isr_handler_remove(pDht->pin);
+    pCap->waiter = NULL;
+    pCap->owner = NULL;
+    // END time-sensitive code. 
+
+    int pulseCount = 0;
+    int response = -1;
+    uint8_t edgeCount = pCap->edgeCount;
+    uint32_t mhz = ets_get_cpu_frequency();
+    threshold = dhtCalibrateEdges(pCap->ccount, pCap->level, edgeCount, DHT_BIT_THRESHOLD_US * mhz, threshold);
+    dht_result_t result = dhtDecodeEdges(pCap->ccount, pCap->level, edgeCount, threshold, frame, &pulseCount, &response);
+    if (result != DHT_OK) {
+        dhtEventRecord(pDht->pin, result, response < 0 ? DHT_PHASE_RESPONSE_LOW : DHT_PHASE_PAYLOAD, __LINE__, edgeCount, (uint8_t)pulseCount, 0);
+        return result;
+    }
+
+    // sensor's response: LOW from the previous falling edge, then the HIGH ending at 'response';
+    // the payload runs from there to the last falling edge
+    dhttiming_t *pTiming = &((dhtpvt_t *)pDht->opaque)->timing;
+    if (response >= 1) {
+        dhtMarkPhase(pTiming, DHT_PHASE_RESPONSE_HIGH, pCap->ccount[response] - pCap->ccount[response-1]);
+        if (response >= 2) {
+            dhtMarkPhase(pTiming, DHT_PHASE_RESPONSE_LOW, pCap->ccount[response-1] - pCap->ccount[response-2]);
+        }
+
+        int last = edgeCount - 1;
+        while (last > response && pCap->level[last] != DHT_LOW) {
+            last--;
+        }
+        dhtMarkPhase(pTiming, DHT_PHASE_PAYLOAD, pCap->ccount[last] - pCap->ccount[response]);
+    }
+
+    dhtNoteThreshold(pDht, threshold, mhz);
+    return DHT_OK;
+}
+#endif
+
+#if DHT_USE_DMA_CAPTURE == 1
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtReadRawDataDma - Private method to read data from DHT bus by letting 
+ *                      the I2S receiver's DMA oversample the DATA line.
+ *  
+ *  Inputs
+ *      pDht     : pointer to pin info
+ *      frame    : pointer to frame buffer (DHT_FRAME_SIZE bytes)
+ *      threshold: HIGH-phase width in cycles above which a bit reads as 1
+ *
+ *  Returns dht_result_t  
+ * 
+ *  Notes 
+ *      Same start sequence as dhtReadRawData. The receiver is started 
+ *      before the line is released and GPIO12 is handed to I2SI_DATA, then
+ *      the task blocks in i2s_read until DHT_DMA_CAPTURE_US of samples are
+ *      in; no CPU time is spent on the frame until it is run-length decoded
+ *      into edges for dhtDecodeEdges. Edge times are sample indexes, so the
+ *      thresholds are converted from cycles and back.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+dht_result_t
+dhtReadRawDataDma(dht_t *pDht, uint8_t *frame, uint32_t threshold) {
+    dht_result_t result = dhtSendStartSignal(pDht);
+    if (result != DHT_OK) {
+        return result;
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(BEGIN_READ_CYCLE_LOW));
+
+    // START time-sensitive code.
+    // send HIGH signal to tell DHT sensor that MCU is ready to receive data
+    if (gpio_set_level(pDht->pin, DHT_HIGH) != ESP_OK) {
+        dhtEventRecord(pDht->pin, DHT_FAILED_TO_SET_PIN_LEVEL, DHT_PHASE_START, __LINE__, 0, 0, 0);
+        return DHT_FAILED_TO_SET_PIN_LEVEL;
+    }
+
+    // start sampling before releasing the line so the response is not missed
+    if (i2s_start(I2S_NUM_0) != ESP_OK) {
+        dhtEventRecord(pDht->pin, DHT_FAILED_TO_SET_PIN_MODE, DHT_PHASE_START, __LINE__, 0, 0, 0);
+        return DHT_FAILED_TO_SET_PIN_MODE;
+    }
+
+    ets_delay_us(BEGIN_READ_CYCLE_HIGH);
+
+    dhttiming_t *pTiming = &((dhtpvt_t *)pDht->opaque)->timing;
+    dhtMarkPhase(pTiming, DHT_PHASE_START, dhtGetCycleCount() - pTiming->start);
+
+    if (gpio_set_direction(pDht->pin, GPIO_MODE_INPUT) != ESP_OK) {
+        dhtEventRecord(pDht->pin, DHT_FAILED_TO_SET_PIN_DIRECTION, DHT_PHASE_START, __LINE__, 0, 0, 0);
+        i2s_stop(I2S_NUM_0);
+        return DHT_FAILED_TO_SET_PIN_DIRECTION;
+    }
+    PIN_FUNC_SELECT(PERIPHS_IO_MUX_MTDI_U, FUNC_I2SI_DATA);
+
+    // sleep while the DMA fills the buffer
+    size_t bytes = 0;
+    i2s_read(I2S_NUM_0, gDma.words, sizeof(gDma.words), &bytes, pdMS_TO_TICKS(DHT_DMA_READ_TIMEOUT));
+    i2s_stop(I2S_NUM_0);
+    PIN_FUNC_SELECT(PERIPHS_IO_MUX_MTDI_U, FUNC_GPIO12);
+    // END time-sensitive code. 
+
+    // each stereo frame lands with the first channel received in its upper half word
+    uint32_t wordCount = (uint32_t)(bytes / sizeof(uint16_t)) & ~1u;
+    for (uint32_t x=0; x<wordCount; x+=2) {
+        uint16_t first = gDma.words[x+1];
+        gDma.words[x+1] = gDma.words[x];
+        gDma.words[x] = first;
+    }
+
+    int pulseCount = 0;
+    int response = -1;
+    uint32_t mhz = ets_get_cpu_frequency();
+    int edgeCount = dhtSamplesToEdges(gDma.words, wordCount, DHT_DMA_MIN_RUN_US * DHT_DMA_SAMPLES_PER_US,
+                                      gDma.ccount, gDma.level, DHT_DMA_MAX_EDGES);
+    threshold = dhtCalibrateEdges(gDma.ccount, gDma.level, edgeCount, DHT_BIT_THRESHOLD_US * DHT_DMA_SAMPLES_PER_US,
+                                  threshold * DHT_DMA_SAMPLES_PER_US / mhz);
+    result = dhtDecodeEdges(gDma.ccount, gDma.level, edgeCount, threshold, frame, &pulseCount, &response);
+    if (result != DHT_OK) {
+        dhtEventRecord(pDht->pin, result, response < 0 ? DHT_PHASE_RESPONSE_LOW : DHT_PHASE_PAYLOAD, __LINE__,
+                       (uint8_t)edgeCount, (uint8_t)pulseCount, 0);
+        return result;
+    }
+
+    // same phases as dhtIsrEndCapture, converted from samples to cycles
+    if (response >= 1) {
+        uint32_t scale = mhz / DHT_DMA_SAMPLES_PER_US;
+        dhtMarkPhase(pTiming, DHT_PHASE_RESPONSE_HIGH, (gDma.ccount[response] - gDma.ccount[response-1]) * scale);
+        if (response >= 2) {
+            dhtMarkPhase(pTiming, DHT_PHASE_RESPONSE_LOW, (gDma.ccount[response-1] - gDma.ccount[response-2]) * scale);
+        }
+
+        int last = edgeCount - 1;
+        while (last > response && gDma.level[last] != DHT_LOW) {
+            last--;
+        }
+        dhtMarkPhase(pTiming, DHT_PHASE_PAYLOAD, (gDma.ccount[last] - gDma.ccount[response]) * scale);
+    }
+
+    dhtNoteThreshold(pDht, threshold, DHT_DMA_SAMPLES_PER_US);
+    return DHT_OK;
+}
+#endif
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtAsyncTimerCallback - Private timer callback driving dhtReadAsync.
+ *
+ *  Notes
+ *      Fires once when the start signal has lasted long enough, and with
+ *      DHT_USE_ISR_CAPTURE once more if the ISR did not report a complete
+ *      frame within DHT_ISR_CAPTURE_TIMEOUT.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static void
+dhtAsyncTimerCallback(TimerHandle_t timer) {
+    dht_t *pDht = (dht_t *)pvTimerGetTimerID(timer);
+    dhtpvt_t *pvt = (dhtpvt_t *)pDht->opaque;
+
+    if (pvt->asyncState == DHT_ASYNC_START_SIGNAL) {
+        #if DHT_USE_ISR_CAPTURE == 1
+        pvt->asyncState = DHT_ASYNC_CAPTURE;
+        dht_result_t result = dhtIsrBeginCapture(pDht, NULL);
+        if (result != DHT_OK) {
+            dhtAsyncComplete(pDht, result, NULL);
+            return;
+        }
+
+        if (xTimerChangePeriod(timer, pdMS_TO_TICKS(DHT_ISR_CAPTURE_TIMEOUT), 0) != pdPASS) {
+            ESP_LOGE(DHT_TAG, "DHT::readAsync: Failed to start capture timeout. (%d)", __LINE__);
+            dhtAsyncCaptureDone(pDht, 0);
+        }
+        #else
+        uint8_t frame[DHT_FRAME_SIZE] = {0};
+        dht_result_t result = dhtPollFrame(pDht, frame, dhtBitThreshold(pDht));
+        dhtAsyncComplete(pDht, result, frame);
+        #endif
+    }
+    #if DHT_USE_ISR_CAPTURE == 1
+    else if (pvt->asyncState == DHT_ASYNC_CAPTURE) {
+        // frame did not complete in time, decode whatever was captured
+        dhtAsyncCaptureDone(pDht, 0);
+    }
+    #endif
+}
+
+#if DHT_USE_ISR_CAPTURE == 1
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtAsyncCaptureDone - Private method run in the timer task once an async 
+ *                        ISR capture completed or timed out.
+ *
+ *  Inputs
+ *      param: dht_t being read
+ *      unused
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static void
+dhtAsyncCaptureDone(void *param, uint32_t unused) {
+    dht_t *pDht = (dht_t *)param;
+    dhtpvt_t *pvt = (dhtpvt_t *)pDht->opaque;
+
+    // the ISR and the timeout can both report, only the first one counts
+    if (pvt->asyncState != DHT_ASYNC_CAPTURE) {
+        return;
+    }
+
+    xTimerStop(pvt->asyncTimer, 0);
+
+    uint8_t frame[DHT_FRAME_SIZE] = {0};
+    dht_result_t result = dhtIsrEndCapture(pDht, frame, dhtBitThreshold(pDht));
+    dhtAsyncComplete(pDht, result, frame);
+}
+#endif
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtAsyncComplete - Private method to decode an async frame and deliver the
+ *                     result through the callback or task notification.
+ *
+ *  Inputs
+ *      pDht  : dht_t being read
+ *      result: outcome of the capture
+ *      frame : captured frame, only used when result is DHT_OK
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+static void
+dhtAsyncComplete(dht_t *pDht, dht_result_t result, const uint8_t *frame) {
+    dhtpvt_t *pvt = (dhtpvt_t *)pDht->opaque;
+    dht_data_t data;
+
+    memset(&data, 0, sizeof(dht_data_t));
+    if (result == DHT_OK) {
+        result = dhtProcessRawData(pDht->pin, frame, &data);
+    }
+
+    if (result == DHT_OK) {
+        dhtCacheResult(pDht, frame);
+    }
+
+    dhtRecordResult(pDht, result);
+    pvt->asyncResult = result;
+    pvt->asyncData = data;
+    pvt->asyncState = DHT_ASYNC_IDLE;
+
+    if (pvt->asyncCallback != NULL) {
+        pvt->asyncCallback(pDht, result, &data, pvt->asyncArg);
+    } else if (pvt->asyncTask != NULL) {
+        xTaskNotify(pvt->asyncTask, (uint32_t)result, eSetValueWithOverwrite);
+    }
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtValidateFrame - Private Method to check a raw frame's Checksum without
+ *                     converting it
+ *  
+ *  Inputs
+ *      pin    : DATA line the frame came from, for the event record
+ *      frame  : pointer to frame buffer (DHT_FRAME_SIZE bytes)
+ *
+ *  Returns - dht_result_t
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static dht_result_t
+dhtValidateFrame(uint8_t pin, const uint8_t *frame) {
+    if (!dhtFrameValid(frame)) {
+        dhtEventRecord(pin, DHT_INVALID_CHECKSUM, DHT_PHASE_PAYLOAD, __LINE__, DHT_FRAME_BITS, frame[4],
+                        (uint8_t)(frame[0] + frame[1] + frame[2] + frame[3]));
+        return DHT_INVALID_CHECKSUM;
+    }
 
     #if DEBUG == 1
-    ESP_LOGI(DHT_TAG, "DHT::read: RH = %d (0x%x)", rh, rh);
-    ESP_LOGI(DHT_TAG, "DHT::read: TEMP = %d C (0x%x)", temp, temp);
-    ESP_LOGI(DHT_TAG, "DHT::read: checksum = 0x%x", checksum);
+    dhtEventRecord(pin, DHT_EVENT_TRACE, DHT_PHASE_TOTAL, __LINE__, DHT_FRAME_BITS, frame[4],
+                    ((uint32_t)frame[0] << 24) | ((uint32_t)frame[1] << 16) | ((uint32_t)frame[2] << 8) | frame[3]);
     #endif
 
-    outdata->csTempWhole    = temp/10;
-    outdata->csTempFraction = (temp*10)%100;    // math for fahrenheit conversion divides by 100 showing extra zero decimal place, do same here for consistency in display.
-    outdata->rhWhole        = rh/10;
-    outdata->rhFraction     = rh%10;
-    temp *= 100;    // get rid of fraction altogether
-    temp /= 50;     // convert to fahrenheit
-    temp *= 9;
-    outdata->faTempWhole    = temp/100 + 32;
-    outdata->faTempFraction = temp%100;
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ *  dhtProcessRawData - Private Method to convert raw DHT sensor data to Temp, 
+ *                      RH, and Checksum 
+ *  
+ *  Inputs
+ *      pin    : DATA line the frame came from, for the event record
+ *      frame  : pointer to frame buffer (DHT_FRAME_SIZE bytes)
+ *      outdata: pointer to dht_data_t struct
+ *
+ *  Returns - dht_result_t
+ *
+ *  Notes 
+ *      Decoding lives in dht22_decode.c so it can be replayed on the host,
+ *      this wrapper only adds the event records.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+dht_result_t
+dhtProcessRawData(uint8_t pin, const uint8_t *frame, dht_data_t *outdata) {
+    dht_result_t result = dhtValidateFrame(pin, frame);
+    if (result != DHT_OK) {
+        return result;
+    }
+
+    return dhtDecodeFrame(frame, outdata);
+}
+
+#if DHT_BENCH == 1
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *  
+ * dhtBenchSampling - Public method to measure how fast each GPIO read path can
+ *                    poll the DATA line.
+ *
+ * Inputs
+ *      pDht - initialized dht_t, its pin is polled but not driven.
+ *
+ * Returns dht_result_t, results are logged as samples per micro-second.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */ 
+dht_result_t
+dhtBenchSampling(dht_t *pDht) {
+    if (pDht == NULL) {
+        ESP_LOGE(DHT_TAG, "DHT::bench: input 'dht' cannot be NULL.");
+        return DHT_INVALID_INPUT;
+    }
+
+    uint32_t mhz = ets_get_cpu_frequency();
+    volatile int sink = 0;
+
+    uint32_t start = dhtGetCycleCount();
+    for (int x=0; x<DHT_BENCH_SAMPLES; x++) {
+        sink += gpio_get_level(pDht->pin);
+    }
+    uint32_t driverCycles = dhtGetCycleCount() - start;
+
+    start = dhtGetCycleCount();
+    for (int x=0; x<DHT_BENCH_SAMPLES; x++) {
+        sink += DHT_READ_PIN(pDht->pin);
+    }
+    uint32_t pathCycles = dhtGetCycleCount() - start;
+
+    // samples/us = samples * mhz / cycles, shown with two decimal places
+    uint32_t driverRate = (DHT_BENCH_SAMPLES * mhz * 100) / driverCycles;
+    uint32_t pathRate   = (DHT_BENCH_SAMPLES * mhz * 100) / pathCycles;
+
+    ESP_LOGI(DHT_TAG, "DHT::bench: gpio_get_level: %d.%02d samples/us (%d cycles/sample)", 
+                driverRate/100, driverRate%100, driverCycles/DHT_BENCH_SAMPLES);
+    ESP_LOGI(DHT_TAG, "DHT::bench: %s: %d.%02d samples/us (%d cycles/sample)", 
+                DHT_USE_FAST_GPIO == 1 ? "GPIO_IN register" : "gpio_get_level (fast path disabled)",
+                pathRate/100, pathRate%100, pathCycles/DHT_BENCH_SAMPLES);
 
     return DHT_OK;
 }
+#endif
@@ -7,41 +7,94 @@
 #ifndef _dht22_h_
 #define _dht22_h_
 
-// set to 1 to display debugging info 
-#ifndef DEBUG
-#define DEBUG 0  
-#endif
+#include "dht22_decode.h"   // dht_result_t, dht_data_t, frame decoding, dht22_config.h
 
 #define DHT_MAX_SENSOR_NAME 32
 
-typedef enum _dht_result_t {
-    DHT_OK,
-    DHT_INVALID_INPUT,
-    DHT_MALLOC_FAILED,
-    DHT_FAILED_TO_SET_PIN_MODE,
-    DHT_READ_QUERY_TOO_FREQUENT,
-    DHT_FAILED_TO_SET_PIN_DIRECTION,
-    DHT_FAILED_TO_SET_PIN_LEVEL,
-    DHT_SENSOR_DID_NOT_SWITCH_TO_HIGH,
-    DHT_SENSOR_DID_NOT_SWITCH_TO_LOW,
-    DHT_INVALID_CHECKSUM  
-}dht_result_t;
+// protocol phases timed by the read path, see dhtGetStats
+typedef enum _dht_phase_t {
+    DHT_PHASE_TOTAL,            // start signal to decoded result
+    DHT_PHASE_START,            // MCU start pulse, LOW plus the release HIGH
+    DHT_PHASE_RESPONSE_LOW,     // sensor's 80us LOW response
+    DHT_PHASE_RESPONSE_HIGH,    // sensor's 80us HIGH response
+    DHT_PHASE_PAYLOAD,          // 40 data bits
+    DHT_PHASE_MAX
+}dht_phase_t;
+
+#define DHT_HIST_BUCKETS 8      // latency histogram buckets per phase
 
 typedef struct _dht_t {
     char       name[DHT_MAX_SENSOR_NAME];    // Room for 31 characters + null terminator.
     uint8_t    pin;
     void *     opaque;      // Contains pointer to private struct to capture context
-    TickType_t pc;
+    TickType_t pc;          // tick count of the last start signal
 }dht_t;
 
-typedef struct _dht_data_t {
-    uint16_t faTempWhole;       // fahrenheit result
-    uint16_t faTempFraction;
-    uint16_t csTempWhole;       // celsius result - sensor returns celsius by default range: [-40,80]
-    uint16_t csTempFraction;
-    uint16_t rhWhole;
-    uint16_t rhFraction;        // range: [0,100] percent
-}dht_data_t;
+// per-sensor state worth keeping across a deep sleep, see dhtSaveState
+typedef struct _dht_state_t {
+    uint8_t  pin;               // sensor the state belongs to
+    uint8_t  bitThresholdUs;    // HIGH pulse width separating a 0 from a 1 bit
+    uint16_t reserved;
+    uint32_t lastReadAgeMs;     // age of the last start signal when saved, DHT_STATE_NEVER_READ if none
+}dht_state_t;
+
+#define DHT_STATE_NEVER_READ 0xffffffff
+
+typedef struct _dht_latency_t {
+    uint32_t count;             // reads that measured this phase
+    uint32_t minUs;
+    uint32_t avgUs;
+    uint32_t maxUs;
+    uint32_t bucketUs;          // width of each histogram bucket, last bucket is open-ended
+    uint32_t histogram[DHT_HIST_BUCKETS];
+}dht_latency_t;
+
+typedef struct _dht_stats_t {
+    uint32_t      successCount; // reads that returned a fresh valid frame
+    uint32_t      errorCount;   // reads that failed, any result other than DHT_OK
+    uint32_t      cacheHits;    // reads served from the last-good-value cache
+    uint32_t      results[DHT_RESULT_MAX];      // per dht_result_t count
+    dht_latency_t latency[DHT_PHASE_MAX];       // per dht_phase_t, successful reads only
+    uint32_t      jitterLastUs; // longest gap between two DATA samples in the last polled read
+    uint32_t      jitterMaxUs;  // worst such gap seen, preemption the capture survived or failed on
+    uint32_t      maskedMaxUs;  // longest interrupts-masked stretch, DHT_CRITICAL_CAPTURE only
+    uint8_t       bitThresholdUs; // learned 0/1 split, each frame rescales it to its own response
+    uint16_t      powerSettleMs;  // learned power-up to read wait, 0 without dhtSetPower
+    uint32_t      powerCycles;    // power cycles forced to recover a sensor that stopped answering
+}dht_stats_t;
+
+// supply switch of a sensor, see dhtSetPower
+typedef struct _dht_power_t {
+    uint8_t pin;                // GPIO driving the sensor's supply (MOSFET gate)
+    bool    activeHigh;         // level that powers the sensor, false for a P-MOSFET high-side switch
+    bool    gate;               // power down between reads; false keeps it on and only cycles to recover
+}dht_power_t;
+
+// validated frame as received, decode on demand with dhtFrameCelsius/Fahrenheit/Humidity
+typedef struct _dht_raw_t {
+    uint8_t    frame[DHT_FRAME_SIZE];
+    TickType_t ticks;           // tick count of the start signal that captured the frame
+    uint32_t   ageMs;           // age of the frame, 0 unless fromCache
+    bool       fromCache;       // last valid frame, served within the 2 second window
+}dht_raw_t;
+
+/*
+ *  Fill a dht_data_t from a frame returned by dhtReadRaw.
+ */
+static inline void
+dhtDecodeRaw(const dht_raw_t *raw, dht_data_t *data) {
+    data->csTemp = dhtFrameCelsius(raw->frame);
+    data->faTemp = dhtCelsiusToFahrenheit(data->csTemp);
+    data->rh = dhtFrameHumidity(raw->frame);
+    data->ageMs = raw->ageMs;
+    data->fromCache = raw->fromCache;
+}
+
+/*
+ *  Completion callback for dhtReadAsync. Runs in the FreeRTOS timer task,
+ *  data is only valid for the duration of the call.
+ */
+typedef void (*dht_callback_t)(dht_t *dht, dht_result_t result, const dht_data_t *data, void *arg);
 
 /*
  *  Initialize dht for reading.
@@ -50,8 +103,18 @@ typedef struct _dht_data_t {
 dht_result_t 
 dhtInitialize(uint8_t pinId, char *name, dht_t **ppDht);
 
+#if DHT_STATIC_POOL_SIZE > 0
 /*
- *  Cleanup timer structure.
+ *  Initialize dht in one of DHT_STATIC_POOL_SIZE static slots, no heap is
+ *  touched. Returns DHT_MALLOC_FAILED when the pool is exhausted.
+ */
+dht_result_t 
+dhtInitializeStatic(uint8_t pinId, char *name, dht_t **ppDht);
+#endif
+
+/*
+ *  Cleanup timer structure and free the sensor, or return its slot to the
+ *  static pool.
  *  Input: pointer to pointer to DHT created in initialize call.
  */
 dht_result_t
@@ -63,12 +126,131 @@ dhtCleanup(dht_t** ppDht);
  *      pinId - GPIO pin to read/write to
  *      name  - sensor name
  *  Returns:
- *      TRUE  - success, data pointer will contain output.
+ *      TRUE  - success, data pointer will contain output. Within 2 seconds
+ *              of the previous read this is the cached last valid reading
+ *              (fromCache set, ageMs gives its age).
  *      FALSE - input data pointer is null, 
  *              error reading DATA pin, or 
- *              consecutive call less than 2 seconds in frequency.
+ *              consecutive call less than 2 seconds in frequency with no
+ *              valid reading cached yet.
  */
 dht_result_t 
 dhtRead(dht_t *dht, dht_data_t *outdata);
 
+/*
+ *  dhtRead without the conversion: returns the checksum-validated frame
+ *  and when it was captured, for callers that store or forward frames or
+ *  decode them later, outside the reading task. Same cache and results
+ *  as dhtRead.
+ */
+dht_result_t
+dhtReadRaw(dht_t *dht, dht_raw_t *outraw);
+
+/*
+ *  Start a read and return immediately.
+ *  Inputs:
+ *      dht      - sensor to read
+ *      callback - receives result and data, or NULL to have the calling 
+ *                 task notified with the dht_result_t as notification value
+ *      arg      - passed to callback
+ *  Returns:
+ *      DHT_OK   - read started, completion is delivered later.
+ *      DHT_BUSY - a read on this sensor is already in progress.
+ *      DHT_READ_QUERY_TOO_FREQUENT, pin and timer errors.
+ */
+dht_result_t
+dhtReadAsync(dht_t *dht, dht_callback_t callback, void *arg);
+
+/*
+ *  Fetch result and data of the last dhtReadAsync, for callers that use
+ *  the task notification. Returns DHT_BUSY while the read is in progress.
+ */
+dht_result_t
+dhtGetAsyncResult(dht_t *dht, dht_data_t *outdata);
+
+/*
+ *  Copy the sensor's read counters and latency statistics into 'stats'.
+ *  Counters are kept by every read path and never allocate. The copy is 
+ *  not atomic with respect to an async read completing at the same time.
+ */
+dht_result_t
+dhtGetStats(dht_t *dht, dht_stats_t *stats);
+
+/*
+ *  Zero the sensor's read counters and latency statistics.
+ */
+dht_result_t
+dhtResetStats(dht_t *dht);
+
+/*
+ *  Ticks until the sensor accepts a new read, 0 when it may be read now.
+ */
+TickType_t
+dhtTicksUntilReady(dht_t *dht);
+
+/*
+ *  Snapshot the sensor's timing state and calibration, typically right
+ *  before deep sleep. 'state' is meant to be kept in RTC memory.
+ */
+dht_result_t
+dhtSaveState(dht_t *dht, dht_state_t *state);
+
+/*
+ *  Restore a state saved by dhtSaveState, so a sensor that stayed powered
+ *  can be read as soon as its minimum interval passed, not 2 s after boot.
+ *  Inputs:
+ *      state     - from dhtSaveState, for the same pin
+ *      elapsedMs - wall-clock time since the state was saved (sleep + boot)
+ */
+dht_result_t
+dhtRestoreState(dht_t *dht, const dht_state_t *state, uint32_t elapsedMs);
+
+/*
+ *  Let the driver switch the sensor's supply. Gated sensors are powered up
+ *  by the next read, which waits the learned settle time first, and down
+ *  again when it completes; call dhtPowerUp ahead of a read to overlap the
+ *  wait. After DHT_POWER_CYCLE_FAILURES reads in a row without a response
+ *  the sensor is powered down so the next read restarts it, gated or not.
+ *  DATA is driven LOW while the sensor is off so it is not fed through the
+ *  pull-up.
+ */
+dht_result_t
+dhtSetPower(dht_t *dht, const dht_power_t *power);
+
+/*
+ *  Power a switched sensor up now, a no-op if it is on or not switched.
+ */
+dht_result_t
+dhtPowerUp(dht_t *dht);
+
+/*
+ *  Ticks a switched sensor that is off must be powered before it is read,
+ *  0 if it is on or not switched.
+ */
+TickType_t
+dhtPowerLeadTicks(dht_t *dht);
+
+#if DHT_USE_FAST_GPIO == 1
+/*
+ *  Read several sensors with one simultaneous start signal and a single
+ *  GPIO_IN sampling loop. Sensors must be on distinct pins in GPIO0-15.
+ *  Inputs:
+ *      dhts    - array of 'count' sensors
+ *      outdata - array of 'count' results, written where results[i] is DHT_OK
+ *      results - array of 'count' per-sensor outcomes
+ *  Returns DHT_OK if the batch ran, DHT_INVALID_INPUT otherwise.
+ */
+dht_result_t
+dhtReadMulti(dht_t **dhts, uint8_t count, dht_data_t *outdata, dht_result_t *results);
+#endif
+
+#if DHT_BENCH == 1
+/*
+ *  Log how many DATA line samples per micro-second gpio_get_level and the
+ *  compiled-in read path achieve.
+ */
+dht_result_t
+dhtBenchSampling(dht_t *dht);
+#endif
+
 #endif //_dht22_h_
@@ -0,0 +1,642 @@
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_system.h"
+
+#include "dht22_bus.h"
+
+static const char *DHT_BUS_TAG = "DHTBUS";
+
+// settings are fixed once a task reads the bus
+static inline bool
+dhtBusStarted(const dht_bus_t *pBus) {
+    return pBus->task != NULL || pBus->poller != NULL;
+}
+
+// Forward references
+static void dhtBusTask(void *);
+static void dhtBusSchedule(dht_bus_t *);
+static TickType_t dhtBusStep(dht_bus_t *, bool);
+static TickType_t dhtBusCollect(dht_bus_t *, TickType_t);
+static dht_result_t dhtBusStartAsync(dht_t *);
+static void dhtBusComplete(dht_bus_t *, uint8_t, dht_result_t, const dht_data_t *, TickType_t);
+static void dhtBusPost(dht_bus_t *, uint8_t, dht_result_t, const dht_data_t *);
+static bool dhtBusReschedule(dht_bus_t *, uint8_t, dht_result_t, TickType_t);
+static void dhtBusRecordLateness(dht_bus_sensor_t *, TickType_t);
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtBusInitialize - Public method to prepare a bus for sensor registration.
+ *
+ * Inputs
+ *      pBus          - caller-allocated bus, stays in use until the task exits.
+ *      wakeThreshold - results pending before the consumer is woken.
+ *
+ * Returns dht_result_t.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+dht_result_t
+dhtBusInitialize(dht_bus_t *pBus, uint32_t wakeThreshold) {
+    if (pBus == NULL) {
+        ESP_LOGE(DHT_BUS_TAG, "DHT::busInitialize: 'bus' cannot be NULL. (%d)", __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    memset(pBus, 0, sizeof(dht_bus_t));
+    return dhtRingInitialize(&pBus->ring, pBus->samples, DHT_BUS_RING_SIZE, wakeThreshold);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtBusAdd - Public method to register a sensor with the bus.
+ *
+ * Inputs
+ *      pBus       - initialized bus, not yet started.
+ *      pDht       - sensor created by dhtInitialize.
+ *      intervalMs - read period for this sensor.
+ *      pId        - receives the sensorId reported in dht_sample_t.
+ *
+ * Returns dht_result_t.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+dht_result_t
+dhtBusAdd(dht_bus_t *pBus, dht_t *pDht, uint32_t intervalMs, uint8_t *pId) {
+    if (pBus == NULL || pDht == NULL) {
+        ESP_LOGE(DHT_BUS_TAG, "DHT::busAdd: inputs cannot be NULL. (%d)", __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    if (dhtBusStarted(pBus)) {
+        ESP_LOGE(DHT_BUS_TAG, "DHT::busAdd: bus already started, cannot add '%s'. (%d)", pDht->name, __LINE__);
+        return DHT_BUSY;
+    }
+
+    if (pBus->count >= DHT_BUS_MAX_SENSORS) {
+        ESP_LOGE(DHT_BUS_TAG, "DHT::busAdd: bus is full (%d sensors). (%d)", DHT_BUS_MAX_SENSORS, __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    if (intervalMs < DHT_MIN_READ_INTERVAL) {
+        ESP_LOGE(DHT_BUS_TAG, "DHT::busAdd: interval %dms for '%s' is below the %dms sensor minimum. (%d)",
+                    intervalMs, pDht->name, DHT_MIN_READ_INTERVAL, __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    dht_bus_sensor_t *pSensor = &pBus->sensors[pBus->count];
+    pSensor->dht = pDht;
+    pSensor->interval = pdMS_TO_TICKS(intervalMs);
+    pSensor->next = 0;
+
+    if (pId != NULL) {
+        *pId = pBus->count;
+    }
+
+    pBus->count++;
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtBusStart - Public method to create the scheduling task.
+ *
+ * Inputs
+ *      pBus      - bus with at least one sensor.
+ *      priority  - task priority.
+ *      stackSize - task stack size.
+ *
+ * Returns dht_result_t.
+ *
+ * Notes
+ *      Sensor i gets its first read at i/count of its interval past the
+ *      moment it becomes ready, so sensors sharing a period stay evenly 
+ *      spaced instead of firing back to back. Ready is DHT_MIN_READ_INTERVAL
+ *      after its last start signal, which after a cold boot means 2 s of 
+ *      warm-up and after dhtRestoreState usually means now. In batch mode
+ *      all sensors start in phase, once the last of them is ready, so they
+ *      can be captured together. Aligned, each sensor starts on the first
+ *      multiple of its interval past the moment it is ready.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+dht_result_t
+dhtBusStart(dht_bus_t *pBus, UBaseType_t priority, uint32_t stackSize) {
+    if (pBus == NULL || pBus->count == 0 || pBus->ring.buffer == NULL) {
+        ESP_LOGE(DHT_BUS_TAG, "DHT::busStart: bus not initialized or has no sensors. (%d)", __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    if (dhtBusStarted(pBus)) {
+        ESP_LOGE(DHT_BUS_TAG, "DHT::busStart: bus already started. (%d)", __LINE__);
+        return DHT_BUSY;
+    }
+
+    dhtBusSchedule(pBus);
+
+    pBus->quit = false;
+    if (xTaskCreate(&dhtBusTask, "dhtBusTask", stackSize, pBus, priority, &pBus->task) != pdPASS) {
+        ESP_LOGE(DHT_BUS_TAG, "DHT::busStart: Failed to create bus task. (%d)", __LINE__);
+        pBus->task = NULL;
+        return DHT_MALLOC_FAILED;
+    }
+
+    return DHT_OK;
+}
+
+#if DHT_USE_FAST_GPIO == 1
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtBusSetBatchCapture - Public method to switch the bus to simultaneous
+ *                         multi-pin capture.
+ *
+ * Returns dht_result_t.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+dht_result_t
+dhtBusSetBatchCapture(dht_bus_t *pBus, bool enable) {
+    if (pBus == NULL) {
+        ESP_LOGE(DHT_BUS_TAG, "DHT::busSetBatchCapture: 'bus' cannot be NULL. (%d)", __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    if (dhtBusStarted(pBus)) {
+        ESP_LOGE(DHT_BUS_TAG, "DHT::busSetBatchCapture: bus already started. (%d)", __LINE__);
+        return DHT_BUSY;
+    }
+
+    pBus->batch = enable;
+    return DHT_OK;
+}
+#endif
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtBusSetAligned - Public method to phase-lock sensors to their intervals.
+ *
+ * Returns dht_result_t.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+dht_result_t
+dhtBusSetAligned(dht_bus_t *pBus, bool enable) {
+    if (pBus == NULL) {
+        ESP_LOGE(DHT_BUS_TAG, "DHT::busSetAligned: 'bus' cannot be NULL. (%d)", __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    if (dhtBusStarted(pBus)) {
+        ESP_LOGE(DHT_BUS_TAG, "DHT::busSetAligned: bus already started. (%d)", __LINE__);
+        return DHT_BUSY;
+    }
+
+    pBus->aligned = enable;
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtBusSetRetry - Public method to set how transient failures are retried.
+ *
+ * Inputs
+ *      pBus   - initialized bus, not yet started.
+ *      pRetry - policy, attempts 0 disables retries.
+ *
+ * Returns dht_result_t.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+dht_result_t
+dhtBusSetRetry(dht_bus_t *pBus, const dht_bus_retry_t *pRetry) {
+    if (pBus == NULL || pRetry == NULL) {
+        ESP_LOGE(DHT_BUS_TAG, "DHT::busSetRetry: inputs cannot be NULL. (%d)", __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    if (dhtBusStarted(pBus)) {
+        ESP_LOGE(DHT_BUS_TAG, "DHT::busSetRetry: bus already started. (%d)", __LINE__);
+        return DHT_BUSY;
+    }
+
+    pBus->retry = *pRetry;
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtBusGetStats - Public method to read a sensor's retry counters.
+ *
+ * Returns dht_result_t.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+dht_result_t
+dhtBusGetStats(const dht_bus_t *pBus, uint8_t sensorId, dht_bus_stats_t *stats) {
+    if (pBus == NULL || stats == NULL || sensorId >= pBus->count) {
+        ESP_LOGE(DHT_BUS_TAG, "DHT::busGetStats: invalid bus, sensorId or stats. (%d)", __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    *stats = pBus->sensors[sensorId].stats;
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtBusStop - Public method to signal the scheduling task to exit.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+void
+dhtBusStop(dht_bus_t *pBus) {
+    if (pBus != NULL) {
+        pBus->quit = true;
+    }
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtBusReceive - Public method to drain a batch of results off the shared 
+ *                 ring.
+ *
+ * Returns number of samples copied, 0 if the timeout expired with none.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+uint32_t
+dhtBusReceive(dht_bus_t *pBus, dht_sample_t *samples, uint32_t max, TickType_t timeout) {
+    if (pBus == NULL || pBus->ring.buffer == NULL || samples == NULL || max == 0) {
+        return 0;
+    }
+
+    return dhtRingWait(&pBus->ring, samples, max, timeout);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtBusOverflow - Public method to read the dropped-result counter.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+uint32_t
+dhtBusOverflow(const dht_bus_t *pBus) {
+    return pBus != NULL ? pBus->ring.overflow : 0;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtBusPoll - Public method to read the bus from the calling task instead of
+ *              a bus task.
+ *
+ * Inputs
+ *      pBus    - bus with at least one sensor, never started.
+ *      samples - receives the results.
+ *      max     - capacity of samples.
+ *      timeout - ticks to wait for at least one result.
+ *
+ * Returns number of samples copied, 0 right after starting a read.
+ *
+ * Notes
+ *      The first call sets the first deadlines the way dhtBusStart does.
+ *      Results still pass through the ring, so a sample posted while
+ *      'max' was reached is returned by the next call. Once a read is
+ *      started the call returns, the caller's work overlaps the frame and
+ *      the next call collects the result, waking on the completion 
+ *      notification. Batch mode reads through dhtReadMulti and blocks for 
+ *      the capture.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+uint32_t
+dhtBusPoll(dht_bus_t *pBus, dht_sample_t *samples, uint32_t max, TickType_t timeout) {
+    if (pBus == NULL || pBus->count == 0 || pBus->ring.buffer == NULL || samples == NULL || max == 0) {
+        return 0;
+    }
+
+    if (pBus->task != NULL) {
+        ESP_LOGE(DHT_BUS_TAG, "DHT::busPoll: bus runs its own task, use dhtBusReceive. (%d)", __LINE__);
+        return 0;
+    }
+
+    if (pBus->poller == NULL) {
+        dhtBusSchedule(pBus);
+        pBus->poller = xTaskGetCurrentTaskHandle();
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    while (dhtRingCount(&pBus->ring) == 0 && !pBus->quit) {
+        bool idle = !pBus->inFlight;
+        TickType_t wait = dhtBusStep(pBus, true);
+        if (idle && pBus->inFlight) {
+            break;
+        }
+
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (wait == 0) {
+            continue;
+        }
+
+        if (elapsed >= timeout) {
+            break;
+        }
+        // a completing read notifies this task and ends the wait early
+        xTaskNotifyWait(0, UINT32_MAX, NULL, wait < timeout - elapsed ? wait : timeout - elapsed);
+    }
+
+    return dhtRingPop(&pBus->ring, samples, max);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtBusGetHealth - Public method to read the reading task's stack headroom
+ *                   and the heap.
+ *
+ * Returns dht_result_t.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+dht_result_t
+dhtBusGetHealth(const dht_bus_t *pBus, dht_bus_health_t *health) {
+    if (pBus == NULL || health == NULL) {
+        ESP_LOGE(DHT_BUS_TAG, "DHT::busGetHealth: inputs cannot be NULL. (%d)", __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    TaskHandle_t task = pBus->task != NULL ? pBus->task : pBus->poller;
+    health->stackFree = task != NULL ? (uint32_t)uxTaskGetStackHighWaterMark(task) : 0;
+    health->heapFree = esp_get_free_heap_size();
+    health->heapFreeMin = esp_get_minimum_free_heap_size();
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  dhtBusSchedule - Private method to set every sensor's first deadline, see
+ *                   dhtBusStart.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static void
+dhtBusSchedule(dht_bus_t *pBus) {
+    TickType_t now = xTaskGetTickCount();
+    TickType_t ready = 0;
+    for (int x=0; x<pBus->count; x++) {
+        TickType_t wait = dhtTicksUntilReady(pBus->sensors[x].dht);
+        ready = wait > ready ? wait : ready;
+    }
+
+    for (int x=0; x<pBus->count; x++) {
+        dht_bus_sensor_t *pSensor = &pBus->sensors[x];
+        if (pBus->aligned) {
+            TickType_t first = now + (pBus->batch ? ready : dhtTicksUntilReady(pSensor->dht));
+            pSensor->next = first + (pSensor->interval - first % pSensor->interval) % pSensor->interval;
+        } else {
+            pSensor->next = pBus->batch ? now + ready : now + dhtTicksUntilReady(pSensor->dht) + (pSensor->interval / pBus->count) * x;
+        }
+    }
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  dhtBusTask - Private scheduling task, reads whichever sensors are due next.
+ *
+ *  Inputs
+ *      input: pointer to dht_bus_t
+ *
+ *  Notes
+ *      Reads run one at a time from this task, so two sensors' frames can
+ *      never overlap. In batch mode all sensors due at once share a single
+ *      dhtReadMulti capture instead. A sensor's next deadline is one 
+ *      interval after its previous deadline, not after the read finished,
+ *      so the period stays exact however long reads and queueing take.
+ *      The wait is recomputed from the absolute deadline on every pass,
+ *      which is what vTaskDelayUntil would do for a single sensor. Retries
+ *      fit in between, see dhtBusReschedule. A sensor on a supply switch
+ *      (dhtSetPower) that is off is woken its settle time early to power
+ *      it up, so the read itself starts on time.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static void
+dhtBusTask(void *input) {
+    dht_bus_t *pBus = (dht_bus_t *)input;
+
+    while (!pBus->quit) {
+        TickType_t wait = dhtBusStep(pBus, false);
+        if (wait > 0) {
+            vTaskDelay(wait);
+        }
+    }
+
+    ESP_LOGE(DHT_BUS_TAG, "DHT::busTask: QUIT signal is TRUE. Task exiting loop. (%d)", __LINE__);
+    pBus->task = NULL;
+    vTaskDelete(NULL);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  dhtBusStep - Private method to read whichever sensors are due, shared by
+ *               the bus task and dhtBusPoll.
+ *
+ *  Inputs
+ *      pBus : bus being read
+ *      async: start single sensors with dhtReadAsync and collect them on a
+ *             later step, for dhtBusPoll
+ *
+ *  Returns ticks until the next deadline, power-up or async read timeout,
+ *  0 if reads were completed.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static TickType_t
+dhtBusStep(dht_bus_t *pBus, bool async) {
+    TickType_t now = xTaskGetTickCount();
+    if (pBus->inFlight) {
+        return dhtBusCollect(pBus, now);
+    }
+
+    // earliest deadline first, compared as signed deltas so tick wrap is safe
+    int due = 0;
+    for (int x=1; x<pBus->count; x++) {
+        if ((int32_t)(pBus->sensors[x].next - pBus->sensors[due].next) < 0) {
+            due = x;
+        }
+    }
+
+    // switched-off sensors are powered up their settle time ahead of the deadline
+    int32_t wait = (int32_t)(pBus->sensors[due].next - now);
+    int32_t wake = wait;
+    for (int x=0; x<pBus->count; x++) {
+        TickType_t lead = dhtPowerLeadTicks(pBus->sensors[x].dht);
+        int32_t until = (int32_t)(pBus->sensors[x].next - lead - now);
+        if (lead > 0 && until <= 0) {
+            dhtPowerUp(pBus->sensors[x].dht);
+        } else if (lead > 0 && until < wake) {
+            wake = until;
+        }
+    }
+
+    if (wait > 0) {
+        return (TickType_t)wake;
+    }
+
+    #if DHT_USE_FAST_GPIO == 1
+    if (pBus->batch) {
+        dht_t *      batch[DHT_BUS_MAX_SENSORS];
+        uint8_t      ids[DHT_BUS_MAX_SENSORS];
+        dht_data_t   data[DHT_BUS_MAX_SENSORS];
+        dht_result_t results[DHT_BUS_MAX_SENSORS];
+        uint8_t      batchCount = 0;
+
+        memset(data, 0, sizeof(data));
+
+        for (int x=0; x<pBus->count; x++) {
+            if ((int32_t)(pBus->sensors[x].next - now) <= 0) {
+                dhtBusRecordLateness(&pBus->sensors[x], now);
+                batch[batchCount] = pBus->sensors[x].dht;
+                ids[batchCount++] = (uint8_t)x;
+            }
+        }
+
+        dht_result_t result = dhtReadMulti(batch, batchCount, data, results);
+        TickType_t done = xTaskGetTickCount();
+        for (int x=0; x<batchCount; x++) {
+            dhtBusComplete(pBus, ids[x], result == DHT_OK ? results[x] : result, &data[x], done);
+        }
+        return 0;
+    }
+    #endif
+
+    dht_bus_sensor_t *pSensor = &pBus->sensors[due];
+    dht_data_t data;
+    dht_result_t result;
+    memset(&data, 0, sizeof(data));
+    dhtBusRecordLateness(pSensor, now);
+
+    if (async) {
+        if ((result = dhtBusStartAsync(pSensor->dht)) == DHT_OK) {
+            pBus->inFlight = true;
+            pBus->pending = (uint8_t)due;
+            pBus->pendingSince = now;
+            return pdMS_TO_TICKS(DHT_BUS_ASYNC_TIMEOUT);
+        }
+    } else {
+        result = dhtRead(pSensor->dht, &data);
+    }
+
+    dhtBusComplete(pBus, (uint8_t)due, result, &data, xTaskGetTickCount());
+    return 0;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  dhtBusCollect - Private method to finish the async read dhtBusStep 
+ *                  started, once it completed or DHT_BUS_ASYNC_TIMEOUT 
+ *                  passed.
+ *
+ *  Returns ticks left until the timeout while the read runs, 0 once its
+ *  slot was completed.
+ *
+ *  Notes
+ *      A read past the timeout ends its slot as DHT_BUSY and is counted as
+ *      stalled. The sensor stays busy until the driver's own timeout ends
+ *      the frame, a slot that still finds it busy is counted again.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static TickType_t
+dhtBusCollect(dht_bus_t *pBus, TickType_t now) {
+    dht_data_t data;
+    memset(&data, 0, sizeof(data));
+
+    dht_result_t result = dhtGetAsyncResult(pBus->sensors[pBus->pending].dht, &data);
+    TickType_t elapsed = now - pBus->pendingSince;
+    TickType_t limit = pdMS_TO_TICKS(DHT_BUS_ASYNC_TIMEOUT);
+    if (result == DHT_BUSY && elapsed < limit) {
+        return limit - elapsed;
+    }
+
+    pBus->inFlight = false;
+    dhtBusComplete(pBus, pBus->pending, result, &data, now);
+    return 0;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  dhtBusStartAsync - Private method to start a read delivering its 
+ *                     completion as a notification to the calling task.
+ *
+ *  Returns dht_result_t of dhtReadAsync.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static dht_result_t
+dhtBusStartAsync(dht_t *pDht) {
+    // drop a notification left by a read that timed out earlier
+    xTaskNotifyWait(0, UINT32_MAX, NULL, 0);
+    return dhtReadAsync(pDht, NULL, NULL);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  dhtBusComplete - Private method to end a read finished at 'done': count a
+ *                   stalled read, reschedule and post the slot's result.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static void
+dhtBusComplete(dht_bus_t *pBus, uint8_t sensorId, dht_result_t result, const dht_data_t *pData, TickType_t done) {
+    if (result == DHT_BUSY) {
+        pBus->sensors[sensorId].stats.stalled++;
+    }
+
+    if (dhtBusReschedule(pBus, sensorId, result, done)) {
+        dhtBusPost(pBus, sensorId, result, pData);
+    }
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  dhtBusReschedule - Private method to pick a sensor's next read after one
+ *                     completed at 'done'.
+ *
+ *  Returns true when the result ends the sensor's slot and is to be posted,
+ *  false when a retry was scheduled instead.
+ *
+ *  Notes
+ *      Only capture failures are retried, a frame lost to noise or 
+ *      preemption is likely to come through on the next try. A retry waits
+ *      DHT_MIN_READ_INTERVAL plus the jittered backoff and is only taken if
+ *      another minimum gap still fits before the slot's regular follow-up,
+ *      which stays one interval after the slot's deadline. A follow-up that
+ *      can no longer be met skips ahead whole intervals, keeping the phase.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static bool
+dhtBusReschedule(dht_bus_t *pBus, uint8_t sensorId, dht_result_t result, TickType_t done) {
+    dht_bus_sensor_t *pSensor = &pBus->sensors[sensorId];
+    TickType_t minGap = pdMS_TO_TICKS(DHT_MIN_READ_INTERVAL);
+
+    if (pSensor->retries == 0) {
+        pSensor->slot = pSensor->next;
+    }
+    TickType_t follow = pSensor->slot + pSensor->interval;
+
+    bool transient = result == DHT_SENSOR_DID_NOT_SWITCH_TO_HIGH || result == DHT_SENSOR_DID_NOT_SWITCH_TO_LOW ||
+                     result == DHT_INVALID_CHECKSUM;
+    if (transient && pSensor->retries < pBus->retry.attempts) {
+        uint32_t backoffMs = (uint32_t)pBus->retry.backoffMs << pSensor->retries;
+        uint32_t jitterMs = pBus->retry.jitterMs > 0 ? esp_random() % (pBus->retry.jitterMs + 1) : 0;
+        TickType_t retryAt = done + minGap + pdMS_TO_TICKS(backoffMs + jitterMs);
+
+        if ((int32_t)(follow - (retryAt + minGap)) >= 0) {
+            pSensor->retries++;
+            pSensor->stats.retries++;
+            pSensor->next = retryAt;
+            return false;
+        }
+    }
+
+    if (transient) {
+        pSensor->stats.exhausted += pBus->retry.attempts > 0 ? 1 : 0;
+    } else if (result == DHT_OK && pSensor->retries > 0) {
+        pSensor->stats.recovered++;
+    }
+
+    // a late read or retry must not crowd the regular one
+    while ((int32_t)(follow - (done + minGap)) < 0) {
+        follow += pSensor->interval;
+        pSensor->stats.missed++;
+    }
+    pSensor->next = follow;
+    pSensor->retries = 0;
+    return true;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  dhtBusRecordLateness - Private method to note how late a sensor's regular
+ *                         read starts, retries are late by design.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static void
+dhtBusRecordLateness(dht_bus_sensor_t *pSensor, TickType_t now) {
+    if (pSensor->retries > 0) {
+        return;
+    }
+
+    pSensor->stats.lateLastMs = (now - pSensor->next) * portTICK_PERIOD_MS;
+    if (pSensor->stats.lateLastMs > pSensor->stats.lateMaxMs) {
+        pSensor->stats.lateMaxMs = pSensor->stats.lateLastMs;
+    }
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  dhtBusPost - Private method to push one result onto the shared ring.
+ *
+ *  Notes
+ *      The ring is never waited on; if the consumer falls behind the 
+ *      result is counted in the ring's overflow instead of delaying other
+ *      sensors. A cached value is stamped with the time it was read.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static void
+dhtBusPost(dht_bus_t *pBus, uint8_t sensorId, dht_result_t result, const dht_data_t *pData) {
+    dht_sample_t sample;
+    bool ok = result == DHT_OK;
+
+    sample.sensorId = sensorId;
+    sample.result = (uint8_t)result;
+    sample.flags = (ok && pData->fromCache) ? DHT_SAMPLE_FROM_CACHE : 0;
+    sample.reserved = 0;
+    sample.csTemp = ok ? pData->csTemp : 0;
+    sample.rh = ok ? pData->rh : 0;
+    sample.ticks = xTaskGetTickCount() - ((ok && pData->fromCache) ? pdMS_TO_TICKS(pData->ageMs) : 0);
+
+    dhtRingPush(&pBus->ring, &sample);
+}
@@ -0,0 +1,172 @@
+/*
+ *   DHT22 Bus Manager
+ *   Reads several DHT sensors from a single scheduling task and
+ *   delivers tagged results through one shared sample ring.
+ */
+
+#ifndef _dht22_bus_h_
+#define _dht22_bus_h_
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "dht22.h"
+#include "dht22_ring.h"
+
+#define DHT_BUS_MAX_SENSORS 10
+#define DHT_BUS_RING_SIZE   32  // samples, power of two
+#define DHT_BUS_ASYNC_TIMEOUT 100   // in milli-seconds, how long dhtBusPoll waits on one async read
+
+// retry policy for transient capture failures (no response, checksum)
+typedef struct _dht_bus_retry_t {
+    uint8_t  attempts;          // extra reads per slot, 0 disables retries
+    uint16_t backoffMs;         // added to DHT_MIN_READ_INTERVAL, doubled on every further retry
+    uint16_t jitterMs;          // random 0..jitterMs on top, spreads sensors failing together
+}dht_bus_retry_t;
+
+typedef struct _dht_bus_stats_t {
+    uint32_t retries;           // retry reads issued
+    uint32_t recovered;         // slots saved by a retry
+    uint32_t exhausted;         // slots that failed after retrying, or had no room to retry
+    uint32_t lateLastMs;        // how far past its deadline the last regular read started
+    uint32_t lateMaxMs;
+    uint32_t missed;            // deadlines skipped because the bus fell a whole interval behind
+    uint32_t stalled;           // slots ended DHT_BUSY: read past DHT_BUS_ASYNC_TIMEOUT or still running
+}dht_bus_stats_t;
+
+// resources of the task reading the bus, see dhtBusGetHealth
+typedef struct _dht_bus_health_t {
+    uint32_t stackFree;         // stack never touched, uxTaskGetStackHighWaterMark units
+    uint32_t heapFree;          // free heap now, in bytes
+    uint32_t heapFreeMin;       // lowest free heap since boot, in bytes
+}dht_bus_health_t;
+
+typedef struct _dht_bus_sensor_t {
+    dht_t *         dht;
+    TickType_t      interval;   // read period in ticks
+    TickType_t      next;       // tick count of next scheduled read
+    TickType_t      slot;       // deadline of the current slot, next slot is one interval on
+    uint8_t         retries;    // retries used in the current slot
+    dht_bus_stats_t stats;
+}dht_bus_sensor_t;
+
+typedef struct _dht_bus_t {
+    dht_bus_sensor_t sensors[DHT_BUS_MAX_SENSORS];
+    uint8_t          count;
+    dht_ring_t       ring;      // results of all sensors, bus task is the only producer
+    dht_sample_t     samples[DHT_BUS_RING_SIZE];
+    TaskHandle_t     task;
+    TaskHandle_t     poller;    // task calling dhtBusPoll when there is no bus task
+    bool             inFlight;  // dhtBusPoll started an async read on 'pending', not collected yet
+    uint8_t          pending;
+    TickType_t       pendingSince;
+    bool             batch;     // capture all due sensors together with dhtReadMulti
+    dht_bus_retry_t  retry;
+    bool             aligned;   // deadlines on multiples of each interval, see dhtBusSetAligned
+    volatile bool    quit;
+}dht_bus_t;
+
+/*
+ *  Initialize a caller-allocated bus and its output ring.
+ *  Input: wakeThreshold - samples pending before dhtBusReceive wakes,
+ *                         at most DHT_BUS_RING_SIZE.
+ */
+dht_result_t
+dhtBusInitialize(dht_bus_t *bus, uint32_t wakeThreshold);
+
+/*
+ *  Register an initialized sensor. Must be called before dhtBusStart.
+ *  Inputs:
+ *      dht        - sensor from dhtInitialize
+ *      intervalMs - read period, at least DHT_MIN_READ_INTERVAL
+ *      pId        - receives sensorId used in dht_sample_t, may be NULL
+ */
+dht_result_t
+dhtBusAdd(dht_bus_t *bus, dht_t *dht, uint32_t intervalMs, uint8_t *pId);
+
+/*
+ *  Create the scheduling task. First reads are spread evenly over each
+ *  sensor's interval, starting once the sensor is ready (dhtTicksUntilReady).
+ *  After that every read has an absolute deadline one interval after the
+ *  previous one, so read time and task latency never add up to drift.
+ */
+dht_result_t
+dhtBusStart(dht_bus_t *bus, UBaseType_t priority, uint32_t stackSize);
+
+#if DHT_USE_FAST_GPIO == 1
+/*
+ *  Enable or disable simultaneous capture. When enabled, call before 
+ *  dhtBusStart; sensors with equal intervals are then started in phase and
+ *  every sensor due at the same time is read in a single dhtReadMulti.
+ */
+dht_result_t
+dhtBusSetBatchCapture(dht_bus_t *bus, bool enable);
+#endif
+
+/*
+ *  Put every sensor's deadlines on whole multiples of its interval since
+ *  boot instead of spreading them, so sensors whose intervals divide each
+ *  other sample at the same instants. Call before dhtBusStart.
+ */
+dht_result_t
+dhtBusSetAligned(dht_bus_t *bus, bool enable);
+
+/*
+ *  Set the retry policy, call before dhtBusStart. A failed slot is retried
+ *  only while the retry still leaves DHT_MIN_READ_INTERVAL before the next
+ *  regular read, so the sensor's cadence is kept. Only the slot's final
+ *  result is posted. Off by default.
+ */
+dht_result_t
+dhtBusSetRetry(dht_bus_t *bus, const dht_bus_retry_t *retry);
+
+/*
+ *  Snapshot the retry and scheduling counters of one sensor.
+ */
+dht_result_t
+dhtBusGetStats(const dht_bus_t *bus, uint8_t sensorId, dht_bus_stats_t *stats);
+
+/*
+ *  Single-task alternative to dhtBusStart and dhtBusReceive: runs the
+ *  bus's schedule in the calling task. Starts each sensor's read as it 
+ *  falls due with dhtReadAsync and returns at once, so the caller works 
+ *  while the frame is captured; the next call collects the result, woken
+ *  by the completion notification. Otherwise sleeps until the next 
+ *  deadline and returns as soon as results are posted or 'timeout' ticks
+ *  pass. Batch mode reads with dhtReadMulti and blocks for the capture.
+ *  Same deadlines, retries and stats as the bus task; wakeThreshold is 
+ *  not used. Returns number of samples copied into 'samples', at most 
+ *  'max', 0 after starting a read.
+ */
+uint32_t
+dhtBusPoll(dht_bus_t *bus, dht_sample_t *samples, uint32_t max, TickType_t timeout);
+
+/*
+ *  Snapshot stack headroom of the reading task (bus task, or the task 
+ *  calling dhtBusPoll) and the heap, for sizing stacks from real data.
+ *  stackFree is 0 before the bus runs.
+ */
+dht_result_t
+dhtBusGetHealth(const dht_bus_t *bus, dht_bus_health_t *health);
+
+/*
+ *  Ask the scheduling task to exit after its current read.
+ */
+void
+dhtBusStop(dht_bus_t *bus);
+
+/*
+ *  Wait up to 'timeout' ticks for wakeThreshold results from any sensor,
+ *  then drain up to 'max' of them into 'samples'. Only one task may 
+ *  receive. Returns number of samples copied.
+ */
+uint32_t
+dhtBusReceive(dht_bus_t *bus, dht_sample_t *samples, uint32_t max, TickType_t timeout);
+
+/*
+ *  Results dropped so far because the consumer fell behind.
+ */
+uint32_t
+dhtBusOverflow(const dht_bus_t *bus);
+
+#endif //_dht22_bus_h_
@@ -0,0 +1,197 @@
+/*
+ *   DHT22 Build Configuration
+ *   Compile-time settings of the dht22 component. Firmware builds take them
+ *   from the component's Kconfig (make menuconfig, "DHT sensor"); host
+ *   builds such as tools/dht_replay get the DHT22 defaults. A -D on the
+ *   command line overrides either.
+ */
+
+#ifndef _dht22_config_h_
+#define _dht22_config_h_
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+// sensor variants, DHT_VARIANT selects one
+#define DHT_VARIANT_DHT22   22  // also AM2302: RH and temp in tenths, 16 bits each
+#define DHT_VARIANT_DHT21   21  // also AM2301: DHT22 payload, longer cable rating
+#define DHT_VARIANT_DHT11   11  // whole units in bytes 0 and 2, tenths in 1 and 3
+
+#ifndef DHT_VARIANT
+#if defined(CONFIG_DHT_VARIANT_DHT11)
+#define DHT_VARIANT DHT_VARIANT_DHT11
+#elif defined(CONFIG_DHT_VARIANT_DHT21)
+#define DHT_VARIANT DHT_VARIANT_DHT21
+#else
+#define DHT_VARIANT DHT_VARIANT_DHT22
+#endif
+#endif
+
+// in milli-seconds, sensor minimum between reads
+#ifndef DHT_MIN_READ_INTERVAL
+#ifdef CONFIG_DHT_MIN_READ_INTERVAL
+#define DHT_MIN_READ_INTERVAL CONFIG_DHT_MIN_READ_INTERVAL
+#elif DHT_VARIANT == DHT_VARIANT_DHT11
+#define DHT_MIN_READ_INTERVAL 1000
+#else
+#define DHT_MIN_READ_INTERVAL 2000
+#endif
+#endif
+
+// in milli-seconds, MCU holds DATA LOW this long to start a read
+#ifndef DHT_START_LOW_MS
+#ifdef CONFIG_DHT_START_LOW_MS
+#define DHT_START_LOW_MS CONFIG_DHT_START_LOW_MS
+#elif DHT_VARIANT == DHT_VARIANT_DHT11
+#define DHT_START_LOW_MS 20
+#else
+#define DHT_START_LOW_MS 10
+#endif
+#endif
+
+// in micro-seconds, MCU drives DATA HIGH this long before releasing it
+#ifndef DHT_START_HIGH_US
+#ifdef CONFIG_DHT_START_HIGH_US
+#define DHT_START_HIGH_US CONFIG_DHT_START_HIGH_US
+#else
+#define DHT_START_HIGH_US 40
+#endif
+#endif
+
+// in micro-seconds, sensor's response LOW and HIGH, the per-frame timing reference
+#ifndef DHT_RESPONSE_US
+#ifdef CONFIG_DHT_RESPONSE_US
+#define DHT_RESPONSE_US CONFIG_DHT_RESPONSE_US
+#else
+#define DHT_RESPONSE_US 80
+#endif
+#endif
+
+// in micro-seconds, LOW that precedes every data bit
+#ifndef DHT_BIT_LOW_US
+#ifdef CONFIG_DHT_BIT_LOW_US
+#define DHT_BIT_LOW_US CONFIG_DHT_BIT_LOW_US
+#else
+#define DHT_BIT_LOW_US 50
+#endif
+#endif
+
+// in micro-seconds, HIGH of a 1 bit, the longest the sensor drives
+#ifndef DHT_BIT_ONE_US
+#ifdef CONFIG_DHT_BIT_ONE_US
+#define DHT_BIT_ONE_US CONFIG_DHT_BIT_ONE_US
+#else
+#define DHT_BIT_ONE_US 70
+#endif
+#endif
+
+// in micro-seconds, between ~28us (0) and ~70us (1)
+#ifndef DHT_BIT_THRESHOLD_US
+#ifdef CONFIG_DHT_BIT_THRESHOLD_US
+#define DHT_BIT_THRESHOLD_US CONFIG_DHT_BIT_THRESHOLD_US
+#else
+#define DHT_BIT_THRESHOLD_US 48
+#endif
+#endif
+
+// in micro-seconds, tolerance added to each polled wait
+#ifndef DHT_TIMEOUT_MARGIN_US
+#ifdef CONFIG_DHT_TIMEOUT_MARGIN_US
+#define DHT_TIMEOUT_MARGIN_US CONFIG_DHT_TIMEOUT_MARGIN_US
+#else
+#define DHT_TIMEOUT_MARGIN_US 30
+#endif
+#endif
+
+// set to 1 to display debugging info
+#ifndef DEBUG
+#ifdef CONFIG_DHT_DEBUG
+#define DEBUG 1
+#else
+#define DEBUG 0
+#endif
+#endif
+
+// set to 1 to capture DATA line edges from a GPIO ISR instead of busy-polling,
+// the reading task blocks on a notification while the frame is received
+#ifndef DHT_USE_ISR_CAPTURE
+#ifdef CONFIG_DHT_USE_ISR_CAPTURE
+#define DHT_USE_ISR_CAPTURE 1
+#else
+#define DHT_USE_ISR_CAPTURE 0
+#endif
+#endif
+
+// set to 1 to oversample DATA with the I2S receiver's DMA instead of polling it,
+// DATA must then be on GPIO12 (I2SI_DATA) and the reading task sleeps through the frame
+#ifndef DHT_USE_DMA_CAPTURE
+#ifdef CONFIG_DHT_USE_DMA_CAPTURE
+#define DHT_USE_DMA_CAPTURE 1
+#else
+#define DHT_USE_DMA_CAPTURE 0
+#endif
+#endif
+
+#if DHT_USE_DMA_CAPTURE == 1 && DHT_USE_ISR_CAPTURE == 1
+#error "DHT_USE_DMA_CAPTURE and DHT_USE_ISR_CAPTURE are alternative capture backends, enable one"
+#endif
+
+// set to 1 to sample DATA by reading GPIO_IN directly instead of gpio_get_level,
+// pins 0-15 only (GPIO16 is in the RTC domain)
+#ifndef DHT_USE_FAST_GPIO
+#if defined(CONFIG_DHT_USE_FAST_GPIO) || !defined(ESP_PLATFORM)
+#define DHT_USE_FAST_GPIO 1
+#else
+#define DHT_USE_FAST_GPIO 0
+#endif
+#endif
+
+// set to 1 to build dhtBenchSampling
+#ifndef DHT_BENCH
+#ifdef CONFIG_DHT_BENCH
+#define DHT_BENCH 1
+#else
+#define DHT_BENCH 0
+#endif
+#endif
+
+// set to 1 to mask interrupts while the 40 data bits are polled (~4-5ms per read),
+// trades interrupt and WiFi latency for first-try success, see dht_stats_t jitter
+#ifndef DHT_CRITICAL_CAPTURE
+#ifdef CONFIG_DHT_CRITICAL_CAPTURE
+#define DHT_CRITICAL_CAPTURE 1
+#else
+#define DHT_CRITICAL_CAPTURE 0
+#endif
+#endif
+
+// power-up to first read for a sensor switched by dhtSetPower, the starting
+// point the driver learns the sensor's real settle time down from
+#ifndef DHT_POWER_SETTLE_MS
+#ifdef CONFIG_DHT_POWER_SETTLE_MS
+#define DHT_POWER_SETTLE_MS CONFIG_DHT_POWER_SETTLE_MS
+#else
+#define DHT_POWER_SETTLE_MS 1000
+#endif
+#endif
+
+// consecutive no-response reads after which a switched sensor is power-cycled
+#ifndef DHT_POWER_CYCLE_FAILURES
+#ifdef CONFIG_DHT_POWER_CYCLE_FAILURES
+#define DHT_POWER_CYCLE_FAILURES CONFIG_DHT_POWER_CYCLE_FAILURES
+#else
+#define DHT_POWER_CYCLE_FAILURES 3
+#endif
+#endif
+
+// number of sensor slots reserved for dhtInitializeStatic, 0 leaves it out
+#ifndef DHT_STATIC_POOL_SIZE
+#ifdef CONFIG_DHT_STATIC_POOL_SIZE
+#define DHT_STATIC_POOL_SIZE CONFIG_DHT_STATIC_POOL_SIZE
+#else
+#define DHT_STATIC_POOL_SIZE 0
+#endif
+#endif
+
+#endif //_dht22_config_h_
@@ -0,0 +1,248 @@
+#include <stddef.h>
+
+#include "dht22_decode.h"
+
+#define DHT_LOW  0
+#define DHT_HIGH 1
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  dhtDecodeEdges - Decode captured DATA line edges into a frame.
+ *
+ *  Inputs
+ *      ccount   : cycle count at each edge
+ *      level    : line level right after each edge
+ *      edgeCount: number of edges
+ *      threshold: HIGH-phase width in cycles above which a bit reads as 1
+ *      frame    : pointer to frame buffer (DHT_FRAME_SIZE bytes), zeroed
+ *      pPulses  : receives number of HIGH pulses found
+ *      pResponse: receives edge index ending the response HIGH, may be NULL
+ *
+ *  Returns dht_result_t
+ *
+ *  Notes
+ *      Every rising edge is paired with the next falling edge. The last 40
+ *      HIGH pulses are the data bits, the one before them is the sensor's
+ *      80us response; anything earlier (the tail of the MCU's release
+ *      pulse) is skipped.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+dht_result_t
+dhtDecodeEdges(const uint32_t *ccount, const uint8_t *level, int edgeCount, uint32_t threshold,
+               uint8_t *frame, int *pPulses, int *pResponse) {
+    // count HIGH pulses (rising edge followed by falling edge)
+    int pulseCount = 0;
+    for (int x=1; x<edgeCount; x++) {
+        if (level[x-1] == DHT_HIGH && level[x] == DHT_LOW) {
+            pulseCount++;
+        }
+    }
+
+    *pPulses = pulseCount;
+    if (pResponse != NULL) {
+        *pResponse = -1;
+    }
+
+    if (pulseCount < DHT_FRAME_BITS + 1) {
+        if (edgeCount == 0 || level[edgeCount-1] == DHT_LOW) {
+            return DHT_SENSOR_DID_NOT_SWITCH_TO_HIGH;
+        }
+        return DHT_SENSOR_DID_NOT_SWITCH_TO_LOW;
+    }
+
+    // the last 40 HIGH pulses are the data bits, MSB first
+    int bit = DHT_FRAME_BITS - pulseCount;
+    for (int x=1; x<edgeCount; x++) {
+        if (level[x-1] == DHT_HIGH && level[x] == DHT_LOW) {
+            if (bit >= 0) {
+                dhtDecodeBit(frame, bit, ccount[x] - ccount[x-1], threshold);
+            } else if (bit == -1 && pResponse != NULL) {
+                *pResponse = x;
+            }
+            bit++;
+        }
+    }
+
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  dhtSamplesToEdges - Turn an oversampled line into edges.
+ *
+ *  Inputs
+ *      words    : line samples, earliest bit first (MSB of words[0])
+ *      wordCount: number of 16-bit words
+ *      minRun   : samples a level must hold before it counts as a change
+ *      ccount   : receives sample index of each edge
+ *      level    : receives line level after each edge
+ *      maxEdges : capacity of ccount/level
+ *
+ *  Returns number of edges
+ *
+ *  Notes
+ *      A change is timestamped at its first sample, once it has held for
+ *      minRun samples, so debouncing does not skew the pulse widths.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+int
+dhtSamplesToEdges(const uint16_t *words, uint32_t wordCount, uint32_t minRun, uint32_t *ccount, uint8_t *level, int maxEdges) {
+    if (wordCount == 0 || maxEdges == 0) {
+        return 0;
+    }
+
+    uint8_t  current = (uint8_t)(words[0] >> 15);
+    uint32_t runStart = 0;      // first sample of a candidate change
+    uint32_t runLength = 0;     // samples the candidate has held
+    int      count = 0;
+
+    ccount[count] = 0;
+    level[count++] = current;
+
+    for (uint32_t x=0; x<wordCount && count<maxEdges; x++) {
+        uint16_t word = words[x];
+
+        // a whole word at the current level is the common case
+        if ((current == DHT_HIGH && word == 0xffff) || (current == DHT_LOW && word == 0)) {
+            runLength = 0;
+            continue;
+        }
+
+        for (int bit=15; bit>=0 && count<maxEdges; bit--) {
+            uint8_t sample = (uint8_t)((word >> bit) & 1);
+            if (sample == current) {
+                runLength = 0;
+                continue;
+            }
+
+            if (runLength++ == 0) {
+                runStart = x * 16 + (uint32_t)(15 - bit);
+            }
+            if (runLength >= minRun) {
+                current = sample;
+                ccount[count] = runStart;
+                level[count++] = current;
+                runLength = 0;
+            }
+        }
+    }
+
+    return count;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  dhtCalibrateEdges - Derive the frame's bit threshold from its response.
+ *
+ *  Inputs
+ *      ccount   : cycle count at each edge
+ *      level    : line level right after each edge
+ *      edgeCount: number of edges
+ *      nominal  : DHT_BIT_THRESHOLD_US in cycles, bounds the result
+ *      fallback : threshold to use when the response is unusable
+ *
+ *  Returns threshold in cycles
+ *
+ *  Notes
+ *      Only the response HIGH is used: the response LOW starts while the
+ *      MCU still holds the line, so its width depends on the host.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+uint32_t
+dhtCalibrateEdges(const uint32_t *ccount, const uint8_t *level, int edgeCount, uint32_t nominal, uint32_t fallback) {
+    int pulseCount = 0;
+    for (int x=1; x<edgeCount; x++) {
+        if (level[x-1] == DHT_HIGH && level[x] == DHT_LOW) {
+            pulseCount++;
+        }
+    }
+
+    // the response is the HIGH pulse right before the last 40
+    int skip = pulseCount - (DHT_FRAME_BITS + 1);
+    if (skip < 0) {
+        return fallback;
+    }
+
+    for (int x=1; x<edgeCount; x++) {
+        if (level[x-1] == DHT_HIGH && level[x] == DHT_LOW && skip-- == 0) {
+            return dhtResponseThreshold(ccount[x] - ccount[x-1], nominal, fallback);
+        }
+    }
+    return fallback;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  dhtFormatTenths - Format a fixed-point tenths value for display.
+ *
+ *  Inputs
+ *      tenths: value in tenths
+ *      buf   : output, DHT_TENTHS_STR_SIZE bytes
+ *
+ *  Returns buf
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+char *
+dhtFormatTenths(int16_t tenths, char *buf) {
+    uint32_t whole = (uint32_t)(tenths < 0 ? -dhtTenthsWhole(tenths) : dhtTenthsWhole(tenths));
+    char     digits[5];
+    int      count = 0;
+    char *   p = buf;
+
+    // digits come out least significant first, same multiply-and-shift /10
+    do {
+        uint32_t next = (whole * 52429) >> 19;
+        digits[count++] = (char)('0' + (whole - next * 10));
+        whole = next;
+    } while (whole > 0);
+
+    if (tenths < 0) {
+        *p++ = '-';
+    }
+    while (count > 0) {
+        *p++ = digits[--count];
+    }
+    *p++ = '.';
+    *p++ = (char)('0' + dhtTenthsFraction(tenths));
+    *p = 0;
+    return buf;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  dhtDecodeFrame - Convert a raw DHT frame to Temp, RH, and validate the
+ *                   Checksum
+ *
+ *  Inputs
+ *      frame  : pointer to frame buffer (DHT_FRAME_SIZE bytes)
+ *      outdata: pointer to dht_data_t struct
+ *
+ *  Returns - dht_result_t
+ *
+ *  Notes (DHT22/DHT21, DHT11 sends whole units and a tenths digit per byte)
+ *           i.  16 bits RH       - Tenths of a percent, kept as is.
+ *                                  Range 0-100%
+ *           ii. 16 bits T        - Tenths of a degree C, sign-magnitude.
+ *                                  Range -40-80C, -40-176F
+ *                                  High order bit=1 means negative T
+ *           iii. 8 bits CHECKSUM - Lower Order 8 bits of SUM(i + ii)
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+dht_result_t
+dhtDecodeFrame(const uint8_t *frame, dht_data_t *outdata) {
+    /*
+     *  Frame Map:
+     *      Relative Humidity = frame[0] (high), frame[1] (low)
+     *      Temperature       = frame[2] (high), frame[3] (low)
+     *      Checksum          = frame[4]
+     */
+
+    // validate sensor reading against checksum
+    // sum up the 4 bytes that make up the RH+TEMP
+    // readings individually and keep the lower 8 bits.
+    if (!dhtFrameValid(frame)) {
+        return DHT_INVALID_CHECKSUM;
+    }
+
+    // values stay fixed-point tenths so no division is needed here
+    int16_t temp = dhtFrameCelsius(frame);
+    int16_t rh = dhtFrameHumidity(frame);
+
+    outdata->csTemp         = temp;
+    outdata->faTemp         = dhtCelsiusToFahrenheit(temp);
+    outdata->rh             = rh;
+    outdata->ageMs          = 0;
+    outdata->fromCache      = false;
+
+    return DHT_OK;
+}
@@ -0,0 +1,203 @@
+/*
+ *   DHT22 Frame Decoder
+ *   Pure decode logic shared by the firmware and the host replay harness
+ *   (tools/dht_replay). No SDK or FreeRTOS dependencies.
+ */
+
+#ifndef _dht22_decode_h_
+#define _dht22_decode_h_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "dht22_config.h"   // variant and protocol timing
+
+#define DHT_FRAME_SIZE      5   // RH (2 bytes), TEMP (2 bytes), CHECKSUM
+#define DHT_FRAME_BITS      40
+#define DHT_TENTHS_STR_SIZE  8  // "-3276.8" + null terminator
+
+typedef enum _dht_result_t {
+    DHT_OK,
+    DHT_INVALID_INPUT,
+    DHT_MALLOC_FAILED,
+    DHT_FAILED_TO_SET_PIN_MODE,
+    DHT_READ_QUERY_TOO_FREQUENT,
+    DHT_FAILED_TO_SET_PIN_DIRECTION,
+    DHT_FAILED_TO_SET_PIN_LEVEL,
+    DHT_SENSOR_DID_NOT_SWITCH_TO_HIGH,
+    DHT_SENSOR_DID_NOT_SWITCH_TO_LOW,
+    DHT_INVALID_CHECKSUM,
+    DHT_BUSY,
+    DHT_TIMER_FAILED,
+    DHT_RESULT_MAX              // number of result codes, not a result
+}dht_result_t;
+
+// readings are fixed-point tenths, split them with dhtTenthsWhole/Fraction or dhtFormatTenths
+typedef struct _dht_data_t {
+    int16_t  csTemp;            // celsius in tenths - sensor returns celsius by default range: [-400,800]
+    int16_t  faTemp;            // fahrenheit in tenths, range: [-400,1760]
+    int16_t  rh;                // relative humidity in tenths, range: [0,1000]
+    uint32_t ageMs;             // age of the reading, 0 unless fromCache
+    bool     fromCache;         // served from the last-good-value cache within the 2 second window
+}dht_data_t;
+
+/*
+ *  Shift one data bit into frame, MSB first. 'width' is the bit's HIGH
+ *  phase in cycles, it reads as 1 above 'threshold'.
+ */
+static inline __attribute__((always_inline)) void
+dhtDecodeBit(uint8_t *frame, int bit, uint32_t width, uint32_t threshold) {
+    frame[bit>>3] = (uint8_t)((frame[bit>>3] << 1) | (width > threshold ? 1 : 0));
+}
+
+/*
+ *  Bit threshold scaled from the width of the frame's 80us response HIGH,
+ *  in the same units, so it follows the sensor's own clock and the cable's
+ *  edge shape. Results outside 50%..150% of 'nominal' mean the reference
+ *  was disturbed (preemption, glitch) and 'fallback' is returned instead.
+ *  Multiply-and-shift only, it runs in the capture loop.
+ */
+static inline __attribute__((always_inline)) uint32_t
+dhtResponseThreshold(uint32_t responseHigh, uint32_t nominal, uint32_t fallback) {
+    uint32_t threshold = (responseHigh * ((DHT_BIT_THRESHOLD_US << 8) / DHT_RESPONSE_US)) >> 8;
+    return (threshold >= (nominal >> 1) && threshold <= nominal + (nominal >> 1)) ? threshold : fallback;
+}
+
+/*
+ *  Celsius tenths to fahrenheit tenths, C*9/5 + 32 rounded to nearest.
+ *  7373/4096 is exact to the tenth over the whole sensor range, relies on
+ *  arithmetic right shift of negative values (gcc).
+ */
+static inline int16_t
+dhtCelsiusToFahrenheit(int16_t csTemp) {
+    return (int16_t)((((int32_t)csTemp * 7373 + 2048) >> 12) + 320);
+}
+
+/*
+ *  True if the frame's checksum byte matches its four data bytes. An all
+ *  zero frame, what the decoder produces when every HIGH pulse falls under
+ *  the threshold, sums correctly and is rejected explicitly. An all ones
+ *  frame already fails the checksum (0xfc != 0xff).
+ */
+static inline bool
+dhtFrameValid(const uint8_t *frame) {
+    if ((frame[0] | frame[1] | frame[2] | frame[3]) == 0) {
+        return false;
+    }
+    return (uint8_t)(frame[0] + frame[1] + frame[2] + frame[3]) == frame[4];
+}
+
+/*
+ *  Celsius tenths of a validated frame, without decoding the rest.
+ *  DHT22/DHT21 send sign-magnitude tenths, DHT11 whole units and a tenths
+ *  byte whose top bit is the sign.
+ */
+static inline int16_t
+dhtFrameCelsius(const uint8_t *frame) {
+    #if DHT_VARIANT == DHT_VARIANT_DHT11
+    int16_t temp = (int16_t)(frame[2] * 10 + (frame[3] & 0x7f));
+    return (frame[3] & 0x80) ? -temp : temp;
+    #else
+    int16_t temp = (int16_t)(((uint16_t)(frame[2] & 0x7f) << 8) | frame[3]);
+    return (frame[2] & 0x80) ? -temp : temp;
+    #endif
+}
+
+/*
+ *  Fahrenheit tenths of a validated frame.
+ */
+static inline int16_t
+dhtFrameFahrenheit(const uint8_t *frame) {
+    return dhtCelsiusToFahrenheit(dhtFrameCelsius(frame));
+}
+
+/*
+ *  Relative humidity tenths of a validated frame.
+ */
+static inline int16_t
+dhtFrameHumidity(const uint8_t *frame) {
+    #if DHT_VARIANT == DHT_VARIANT_DHT11
+    return (int16_t)(frame[0] * 10 + frame[1]);
+    #else
+    return (int16_t)(((uint16_t)frame[0] << 8) | frame[1]);
+    #endif
+}
+
+/*
+ *  Whole part of a tenths value, truncated toward zero. Division by 10 is
+ *  done as multiply-and-shift, exact for every int16_t magnitude.
+ */
+static inline int16_t
+dhtTenthsWhole(int16_t tenths) {
+    uint32_t mag = (uint32_t)(tenths < 0 ? -(int32_t)tenths : tenths);
+    int16_t  whole = (int16_t)((mag * 52429) >> 19);
+    return tenths < 0 ? -whole : whole;
+}
+
+/*
+ *  Fractional digit of a tenths value, always positive.
+ */
+static inline uint8_t
+dhtTenthsFraction(int16_t tenths) {
+    uint32_t mag = (uint32_t)(tenths < 0 ? -(int32_t)tenths : tenths);
+    return (uint8_t)(mag - ((mag * 52429) >> 19) * 10);
+}
+
+/*
+ *  Format a tenths value as "[-]whole.fraction" into buf, which must hold
+ *  DHT_TENTHS_STR_SIZE bytes. Keeps the sign of values between -1 and 0.
+ *  Returns buf.
+ */
+char *
+dhtFormatTenths(int16_t tenths, char *buf);
+
+/*
+ *  Decode a list of DATA line edges into a frame.
+ *  Inputs:
+ *      ccount    - cycle count at each edge
+ *      level     - line level right after each edge
+ *      edgeCount - number of edges
+ *      threshold - HIGH width in cycles above which a bit reads as 1
+ *      frame     - DHT_FRAME_SIZE bytes, zeroed by the caller
+ *      pPulses   - receives number of HIGH pulses found
+ *      pResponse - receives edge index of the falling edge that ends the
+ *                  sensor's 80us response HIGH, -1 if none; may be NULL
+ *  Returns DHT_OK when 41 or more HIGH pulses were found, otherwise the
+ *  DHT_SENSOR_DID_NOT_SWITCH_* code matching the last level seen.
+ */
+dht_result_t
+dhtDecodeEdges(const uint32_t *ccount, const uint8_t *level, int edgeCount, uint32_t threshold,
+               uint8_t *frame, int *pPulses, int *pResponse);
+
+/*
+ *  Run-length decode an oversampled DATA line into edges for dhtDecodeEdges.
+ *  Inputs:
+ *      words     - line samples, 16 per word, earliest in the MSB
+ *      wordCount - number of words
+ *      minRun    - samples a new level must hold to count, shorter runs
+ *                  are glitches and stay part of the surrounding level
+ *      ccount    - receives sample index of each edge; the line's first
+ *                  level is reported as an edge at index 0
+ *      level     - receives line level right after each edge
+ *      maxEdges  - capacity of ccount and level
+ *  Returns number of edges, stops early when maxEdges is reached.
+ */
+int
+dhtSamplesToEdges(const uint16_t *words, uint32_t wordCount, uint32_t minRun, uint32_t *ccount, uint8_t *level, int maxEdges);
+
+/*
+ *  dhtResponseThreshold for captured edges: finds the response HIGH the
+ *  same way dhtDecodeEdges does. Returns 'fallback' if the capture holds
+ *  no complete frame.
+ */
+uint32_t
+dhtCalibrateEdges(const uint32_t *ccount, const uint8_t *level, int edgeCount, uint32_t nominal, uint32_t fallback);
+
+/*
+ *  Validate the checksum of a frame and convert it to dht_data_t.
+ *  Returns DHT_OK or DHT_INVALID_CHECKSUM, outdata is untouched on failure.
+ */
+dht_result_t
+dhtDecodeFrame(const uint8_t *frame, dht_data_t *outdata);
+
+#endif //_dht22_decode_h_
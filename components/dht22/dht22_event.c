@@ -0,0 +1,135 @@
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+
+#include "dht22_event.h"
+
+static const char *DHT_EVENT_TAG = "DHT";
+
+#define DHT_EVENT_MASK (DHT_EVENT_RING_SIZE - 1)
+
+// written by whichever task reads a sensor, the bus task or the timer task
+static dht_event_t       gEvents[DHT_EVENT_RING_SIZE];
+static volatile uint32_t gEventHead;
+static volatile uint32_t gEventTail;
+static volatile uint32_t gEventLost;
+
+static const char *gPhaseNames[DHT_PHASE_MAX] = { "total", "start", "response-low", "response-high", "payload" };
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtEventRecord - Public method to store one event for later formatting.
+ *
+ * Notes
+ *      A handful of stores inside a critical section, the cost is the same
+ *      whether or not anyone ever flushes. When the ring is full the
+ *      oldest event is overwritten, recent failures are the useful ones.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+void
+dhtEventRecord(uint8_t pin, uint8_t code, uint8_t phase, uint16_t line, int16_t count, uint8_t extra, uint32_t value) {
+    taskENTER_CRITICAL();
+    if (gEventHead - gEventTail >= DHT_EVENT_RING_SIZE) {
+        gEventTail++;
+        gEventLost++;
+    }
+
+    dht_event_t *pEvent = &gEvents[gEventHead & DHT_EVENT_MASK];
+    pEvent->ticks = xTaskGetTickCount();
+    pEvent->value = value;
+    pEvent->line = line;
+    pEvent->count = count;
+    pEvent->pin = pin;
+    pEvent->code = code;
+    pEvent->phase = phase;
+    pEvent->extra = extra;
+    gEventHead++;
+    taskEXIT_CRITICAL();
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtEventDrain - Public method to take pending events out of the ring.
+ *
+ * Returns number of events copied to out.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+uint32_t
+dhtEventDrain(dht_event_t *out, uint32_t max, uint32_t *pLost) {
+    uint32_t count = 0;
+
+    taskENTER_CRITICAL();
+    while (count < max && gEventTail != gEventHead) {
+        out[count++] = gEvents[gEventTail & DHT_EVENT_MASK];
+        gEventTail++;
+    }
+    if (pLost != NULL) {
+        *pLost = gEventLost;
+    }
+    taskEXIT_CRITICAL();
+
+    return count;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtEventFlush - Public method to format pending events to the log.
+ *
+ * Returns number of events logged.
+ *
+ * Notes
+ *      Events are copied out a few at a time so the critical section stays
+ *      short, the UART output happens with interrupts enabled.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+uint32_t
+dhtEventFlush(void) {
+    static uint32_t reportedLost = 0;
+    dht_event_t events[4];
+    uint32_t total = 0;
+    uint32_t lost = 0;
+    uint32_t count;
+
+    while ((count = dhtEventDrain(events, sizeof(events)/sizeof(events[0]), &lost)) > 0) {
+        for (uint32_t x=0; x<count; x++) {
+            const dht_event_t *e = &events[x];
+            const char *phase = e->phase < DHT_PHASE_MAX ? gPhaseNames[e->phase] : "-";
+
+            switch (e->code) {
+            case DHT_EVENT_TRACE: {
+                uint8_t frame[DHT_FRAME_SIZE] = { e->value >> 24, e->value >> 16, e->value >> 8, e->value, e->extra };
+                dht_data_t data;
+                char rh[DHT_TENTHS_STR_SIZE], temp[DHT_TENTHS_STR_SIZE];
+                dhtDecodeFrame(frame, &data);
+                ESP_LOGI(DHT_EVENT_TAG, "DHT::read: pin:%d frame [0x%02x] [0x%02x] [0x%02x] [0x%02x] [0x%02x] RH = %s, TEMP = %s C ticks=%d (%d)",
+                            e->pin, frame[0], frame[1], frame[2], frame[3], frame[4],
+                            dhtFormatTenths(data.rh, rh), dhtFormatTenths(data.csTemp, temp), e->ticks, e->line);
+                break;
+            }
+            case DHT_SENSOR_DID_NOT_SWITCH_TO_HIGH:
+            case DHT_SENSOR_DID_NOT_SWITCH_TO_LOW:
+                ESP_LOGE(DHT_EVENT_TAG, "DHT::read: pin:%d sensor did not switch to %s in %s phase. bit/edges=%d pulses=%d elapsed=%dus ticks=%d (%d)",
+                            e->pin, e->code == DHT_SENSOR_DID_NOT_SWITCH_TO_HIGH ? "HIGH" : "LOW", phase,
+                            e->count, e->extra, e->value, e->ticks, e->line);
+                break;
+            case DHT_INVALID_CHECKSUM:
+                ESP_LOGE(DHT_EVENT_TAG, "DHT::read: pin:%d checksum failure! CS=0x%x, Calculated-CS=0x%x ticks=%d (%d)",
+                            e->pin, e->extra, e->value, e->ticks, e->line);
+                break;
+            case DHT_READ_QUERY_TOO_FREQUENT:
+                ESP_LOGE(DHT_EVENT_TAG, "DHT::read: pin:%d call frequency cannot be less than 2 seconds. pc=%d ticks=%d (%d)",
+                            e->pin, e->value, e->ticks, e->line);
+                break;
+            default:
+                ESP_LOGE(DHT_EVENT_TAG, "DHT::read: pin:%d failed with result %d in %s phase. ticks=%d (%d)",
+                            e->pin, e->code, phase, e->ticks, e->line);
+                break;
+            }
+        }
+        total += count;
+    }
+
+    if (lost != reportedLost) {
+        ESP_LOGW(DHT_EVENT_TAG, "DHT::events: %d events overwritten before they were flushed.", lost - reportedLost);
+        reportedLost = lost;
+    }
+
+    return total;
+}
@@ -0,0 +1,53 @@
+/*
+ *   DHT22 Event Ring
+ *   Read failures and debug traces are stored as compact records instead of
+ *   being formatted on the spot, so no UART output lengthens a capture or
+ *   the reading task. dhtEventFlush formats them later, from a low
+ *   priority task.
+ */
+
+#ifndef _dht22_event_h_
+#define _dht22_event_h_
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "dht22.h"
+
+#define DHT_EVENT_RING_SIZE 16      // events, power of two; the oldest are overwritten
+
+#define DHT_EVENT_TRACE     DHT_RESULT_MAX  // code of DEBUG == 1 frame traces, value holds frame bytes 0-3, extra the checksum
+
+// one recorded event, 16 bytes
+typedef struct _dht_event_t {
+    TickType_t ticks;       // tick count when recorded
+    uint32_t   value;       // code specific: elapsed us, frame bytes, checksum pair, tick count
+    uint16_t   line;        // source line that recorded it
+    int16_t    count;       // code specific: bit index, edges, pulses
+    uint8_t    pin;
+    uint8_t    code;        // dht_result_t, or DHT_EVENT_TRACE
+    uint8_t    phase;       // dht_phase_t the read was in
+    uint8_t    extra;       // code specific: pulses, checksum byte
+}dht_event_t;
+
+/*
+ *  Record an event. Never blocks or allocates, safe from any task.
+ */
+void
+dhtEventRecord(uint8_t pin, uint8_t code, uint8_t phase, uint16_t line, int16_t count, uint8_t extra, uint32_t value);
+
+/*
+ *  Copy out up to 'max' pending events, oldest first. Returns the number
+ *  copied; *pLost (may be NULL) receives events overwritten so far.
+ */
+uint32_t
+dhtEventDrain(dht_event_t *out, uint32_t max, uint32_t *pLost);
+
+/*
+ *  Drain and log all pending events. Call from a low priority task.
+ *  Returns the number logged.
+ */
+uint32_t
+dhtEventFlush(void);
+
+#endif //_dht22_event_h_
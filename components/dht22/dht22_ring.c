@@ -0,0 +1,125 @@
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+
+#include "dht22_ring.h"
+
+static const char *DHT_RING_TAG = "DHTRING";
+
+// keep the compiler from moving buffer accesses across an index update,
+// the lx106 is single core so no hardware barrier is needed
+#define DHT_RING_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtRingInitialize - Public method to set up a ring over caller storage.
+ *
+ * Inputs
+ *      pRing     - ring to initialize.
+ *      storage   - 'capacity' samples, stays in use for the ring's lifetime.
+ *      capacity  - power of two.
+ *      threshold - pending samples that wake a consumer in dhtRingWait.
+ *
+ * Returns dht_result_t.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+dht_result_t
+dhtRingInitialize(dht_ring_t *pRing, dht_sample_t *storage, uint32_t capacity, uint32_t threshold) {
+    if (pRing == NULL || storage == NULL) {
+        ESP_LOGE(DHT_RING_TAG, "DHT::ringInitialize: inputs cannot be NULL. (%d)", __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0 || threshold == 0 || threshold > capacity) {
+        ESP_LOGE(DHT_RING_TAG, "DHT::ringInitialize: capacity %d must be a power of two and threshold %d in [1,capacity]. (%d)",
+                    capacity, threshold, __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    memset(pRing, 0, sizeof(dht_ring_t));
+    pRing->buffer = storage;
+    pRing->mask = capacity - 1;
+    pRing->threshold = threshold;
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtRingPush - Public producer method to append one sample.
+ *
+ * Returns true if the sample was stored.
+ *
+ * Notes
+ *      The sample is written before head is published, so the consumer
+ *      never sees a half-copied slot. The consumer is notified only when
+ *      this push brings the backlog up to the threshold.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+bool
+dhtRingPush(dht_ring_t *pRing, const dht_sample_t *pSample) {
+    uint32_t head = pRing->head;
+    if (head - pRing->tail > pRing->mask) {
+        pRing->overflow++;
+        return false;
+    }
+
+    pRing->buffer[head & pRing->mask] = *pSample;
+    DHT_RING_BARRIER();
+    pRing->head = head + 1;
+
+    TaskHandle_t waiter = pRing->waiter;
+    if (waiter != NULL && dhtRingCount(pRing) >= pRing->threshold) {
+        pRing->waiter = NULL;
+        xTaskNotifyGive(waiter);
+    }
+
+    return true;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtRingPop - Public consumer method to drain pending samples.
+ *
+ * Returns number of samples copied to out.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+uint32_t
+dhtRingPop(dht_ring_t *pRing, dht_sample_t *out, uint32_t max) {
+    uint32_t tail = pRing->tail;
+    uint32_t count = pRing->head - tail;
+    DHT_RING_BARRIER();
+
+    if (count > max) {
+        count = max;
+    }
+
+    for (uint32_t x=0; x<count; x++) {
+        out[x] = pRing->buffer[(tail + x) & pRing->mask];
+    }
+
+    DHT_RING_BARRIER();
+    pRing->tail = tail + count;
+    return count;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * dhtRingWait - Public consumer method to block for a batch.
+ *
+ * Returns number of samples copied to out, may be less than the threshold
+ * (or 0) when the timeout expired first.
+ *
+ * Notes
+ *      The waiter is registered before the backlog is checked, so a push
+ *      that lands in between still leaves a notification pending and the
+ *      take returns at once.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+uint32_t
+dhtRingWait(dht_ring_t *pRing, dht_sample_t *out, uint32_t max, TickType_t timeout) {
+    if (dhtRingCount(pRing) < pRing->threshold) {
+        pRing->waiter = xTaskGetCurrentTaskHandle();
+        DHT_RING_BARRIER();
+        if (dhtRingCount(pRing) < pRing->threshold) {
+            ulTaskNotifyTake(pdTRUE, timeout);
+        }
+        pRing->waiter = NULL;
+    }
+
+    return dhtRingPop(pRing, out, max);
+}
@@ -0,0 +1,78 @@
+/*
+ *   DHT22 Sample Ring
+ *   Lock-free single-producer/single-consumer ring of compact samples.
+ *   The consumer drains in batches and is only woken once a threshold of
+ *   samples is pending.
+ */
+
+#ifndef _dht22_ring_h_
+#define _dht22_ring_h_
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "dht22.h"
+
+#define DHT_SAMPLE_FROM_CACHE 0x01  // dht_sample_t flags: value came from the last-good cache
+
+// one reading, 12 bytes; fahrenheit is derived with dhtCelsiusToFahrenheit
+typedef struct _dht_sample_t {
+    uint8_t    sensorId;        // id returned by dhtBusAdd
+    uint8_t    result;          // dht_result_t
+    uint8_t    flags;           // DHT_SAMPLE_*
+    uint8_t    reserved;
+    int16_t    csTemp;          // celsius in tenths
+    int16_t    rh;              // relative humidity in tenths
+    TickType_t ticks;           // tick count when the reading was taken
+}dht_sample_t;
+
+typedef struct _dht_ring_t {
+    dht_sample_t *        buffer;       // caller storage, capacity entries
+    uint32_t              mask;         // capacity - 1, capacity is a power of two
+    uint32_t              threshold;    // pending samples that wake the consumer
+    volatile uint32_t     head;         // next write, only the producer moves it
+    volatile uint32_t     tail;         // next read, only the consumer moves it
+    volatile uint32_t     overflow;     // samples dropped because the ring was full
+    volatile TaskHandle_t waiter;       // consumer blocked in dhtRingWait
+}dht_ring_t;
+
+/*
+ *  Set up a ring over caller-provided storage.
+ *  Inputs:
+ *      storage   - 'capacity' samples, capacity must be a power of two
+ *      threshold - wake the consumer once this many samples are pending,
+ *                  between 1 and capacity
+ */
+dht_result_t
+dhtRingInitialize(dht_ring_t *ring, dht_sample_t *storage, uint32_t capacity, uint32_t threshold);
+
+/*
+ *  Producer side. Copies one sample in, never blocks. Returns false and
+ *  counts an overflow when the ring is full.
+ */
+bool
+dhtRingPush(dht_ring_t *ring, const dht_sample_t *sample);
+
+/*
+ *  Consumer side. Copies up to 'max' pending samples out without blocking.
+ *  Returns number of samples copied.
+ */
+uint32_t
+dhtRingPop(dht_ring_t *ring, dht_sample_t *out, uint32_t max);
+
+/*
+ *  Consumer side. Blocks until 'threshold' samples are pending or 'timeout'
+ *  ticks pass, then drains up to 'max'. Returns number of samples copied.
+ */
+uint32_t
+dhtRingWait(dht_ring_t *ring, dht_sample_t *out, uint32_t max, TickType_t timeout);
+
+/*
+ *  Number of samples waiting for the consumer.
+ */
+static inline uint32_t
+dhtRingCount(const dht_ring_t *ring) {
+    return ring->head - ring->tail;
+}
+
+#endif //_dht22_ring_h_
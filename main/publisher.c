@@ -0,0 +1,170 @@
+#include <string.h>
+#include <stdlib.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+
+#include "publisher.h"
+
+static const char *PUBLISHER_TAG = "PUBLISHER";
+
+// Forward references
+static bool publisherIsSignificant(const publisher_t *, const dht_sample_t *);
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * publisherInitialize - Public method to prepare a publisher.
+ *
+ * Inputs
+ *      pPub    - caller-allocated publisher.
+ *      pConfig - thresholds and transport, copied.
+ *
+ * Returns dht_result_t.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+dht_result_t
+publisherInitialize(publisher_t *pPub, const publisher_config_t *pConfig) {
+    if (pPub == NULL || pConfig == NULL || pConfig->send == NULL) {
+        ESP_LOGE(PUBLISHER_TAG, "Publisher::initialize: inputs and 'send' cannot be NULL. (%d)", __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    if (pConfig->batchSize == 0 || pConfig->batchSize > PUBLISHER_MAX_BATCH) {
+        ESP_LOGE(PUBLISHER_TAG, "Publisher::initialize: batch size %d must be in [1,%d]. (%d)",
+                    pConfig->batchSize, PUBLISHER_MAX_BATCH, __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    memset(pPub, 0, sizeof(publisher_t));
+    pPub->config = *pConfig;
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * publisherAdd - Public method to queue one sample for the next packet.
+ *
+ * Returns true if a packet was sent.
+ *
+ * Notes
+ *      When the batch is full because the uplink keeps failing, the oldest
+ *      pending sample is discarded to make room.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+bool
+publisherAdd(publisher_t *pPub, const dht_sample_t *pSample) {
+    if (pPub->count == pPub->config.batchSize) {
+        memmove(&pPub->pending[0], &pPub->pending[1], (pPub->count - 1) * sizeof(dht_sample_t));
+        pPub->count--;
+        pPub->dropped++;
+    }
+
+    if (pPub->count == 0) {
+        pPub->oldest = xTaskGetTickCount();
+    }
+
+    bool significant = publisherIsSignificant(pPub, pSample);
+    pPub->pending[pPub->count++] = *pSample;
+
+    if (significant || pPub->count >= pPub->config.batchSize) {
+        return publisherFlush(pPub);
+    }
+
+    return false;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * publisherPoll - Public method to enforce the maximum latency.
+ *
+ * Returns true if a packet was sent.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+bool
+publisherPoll(publisher_t *pPub) {
+    if (pPub->count == 0 || publisherTimeout(pPub) > 0) {
+        return false;
+    }
+
+    return publisherFlush(pPub);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * publisherFlush - Public method to send all pending samples as one packet.
+ *
+ * Returns true if a packet was sent.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+bool
+publisherFlush(publisher_t *pPub) {
+    if (pPub->count == 0) {
+        return false;
+    }
+
+    if (!pPub->config.send(pPub->pending, pPub->count, pPub->config.arg)) {
+        pPub->failures++;
+        // try again no sooner than one latency period from now
+        pPub->oldest = xTaskGetTickCount();
+        ESP_LOGW(PUBLISHER_TAG, "Publisher::flush: send failed, %d samples kept (failures=%d). (%d)",
+                    pPub->count, pPub->failures, __LINE__);
+        return false;
+    }
+
+    for (uint32_t x=0; x<pPub->count; x++) {
+        const dht_sample_t *pSample = &pPub->pending[x];
+        if (pSample->result == DHT_OK && pSample->sensorId < DHT_BUS_MAX_SENSORS) {
+            pPub->published[pSample->sensorId] = true;
+            pPub->lastTemp[pSample->sensorId] = pSample->csTemp;
+            pPub->lastRh[pSample->sensorId] = pSample->rh;
+        }
+    }
+
+    pPub->packets++;
+    pPub->samples += pPub->count;
+    pPub->count = 0;
+
+    uint32_t spp = publisherSamplesPerPacket(pPub);
+    ESP_LOGI(PUBLISHER_TAG, "Publisher::flush: packet %d sent, %d.%02d samples/packet.", pPub->packets, spp/100, spp%100);
+    return true;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * publisherTimeout - Public method, ticks left before the age flush.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+TickType_t
+publisherTimeout(const publisher_t *pPub) {
+    if (pPub->count == 0) {
+        return portMAX_DELAY;
+    }
+
+    TickType_t age = xTaskGetTickCount() - pPub->oldest;
+    TickType_t limit = pdMS_TO_TICKS(pPub->config.maxLatencyMs);
+    return age >= limit ? 0 : limit - age;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * publisherSamplesPerPacket - Public method, samples/packet x 100.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+uint32_t
+publisherSamplesPerPacket(const publisher_t *pPub) {
+    return pPub->packets > 0 ? (pPub->samples * 100) / pPub->packets : 0;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  publisherIsSignificant - Private method, true if a fresh reading moved
+ *                           past the configured delta since that sensor's
+ *                           last published value.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static bool
+publisherIsSignificant(const publisher_t *pPub, const dht_sample_t *pSample) {
+    if (pSample->result != DHT_OK || (pSample->flags & DHT_SAMPLE_FROM_CACHE) || pSample->sensorId >= DHT_BUS_MAX_SENSORS) {
+        return false;
+    }
+
+    uint8_t id = pSample->sensorId;
+    if (!pPub->published[id]) {
+        // first value of a sensor is always worth sending
+        return true;
+    }
+
+    if (pPub->config.tempDelta > 0 && abs(pSample->csTemp - pPub->lastTemp[id]) >= pPub->config.tempDelta) {
+        return true;
+    }
+
+    return pPub->config.rhDelta > 0 && abs(pSample->rh - pPub->lastRh[id]) >= pPub->config.rhDelta;
+}
@@ -0,0 +1,86 @@
+/*
+ *   Sample Publisher
+ *   Accumulates samples from all sensors and hands them to the uplink in
+ *   one packet, when the batch is full, the oldest sample is too old, or a
+ *   reading changed significantly since it was last published.
+ */
+
+#ifndef _publisher_h_
+#define _publisher_h_
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "dht22_bus.h"
+
+#define PUBLISHER_MAX_BATCH 32
+
+/*
+ *  Uplink transport, sends one packet. Returns false if the packet was not
+ *  delivered; the samples stay pending and go out with the next flush.
+ */
+typedef bool (*publisher_send_t)(const dht_sample_t *samples, uint32_t count, void *arg);
+
+typedef struct _publisher_config_t {
+    uint32_t         batchSize;     // flush once this many samples are pending, at most PUBLISHER_MAX_BATCH
+    uint32_t         maxLatencyMs;  // flush once the oldest pending sample is this old
+    int16_t          tempDelta;     // tenths C change from the last published value that flushes at once, 0 disables
+    int16_t          rhDelta;       // tenths %RH, same as tempDelta
+    publisher_send_t send;
+    void *           arg;           // passed to send
+}publisher_config_t;
+
+typedef struct _publisher_t {
+    publisher_config_t config;
+    dht_sample_t       pending[PUBLISHER_MAX_BATCH];
+    uint32_t           count;
+    TickType_t         oldest;                          // tick count when pending[0] was added
+    bool               published[DHT_BUS_MAX_SENSORS];  // lastTemp/lastRh valid
+    int16_t            lastTemp[DHT_BUS_MAX_SENSORS];
+    int16_t            lastRh[DHT_BUS_MAX_SENSORS];
+    uint32_t           packets;     // packets delivered
+    uint32_t           samples;     // samples delivered
+    uint32_t           failures;    // send calls that failed
+    uint32_t           dropped;     // samples discarded because the batch was full and unsent
+}publisher_t;
+
+/*
+ *  Initialize a caller-allocated publisher.
+ */
+dht_result_t
+publisherInitialize(publisher_t *pub, const publisher_config_t *config);
+
+/*
+ *  Queue one sample, flushing if it fills the batch or is a significant
+ *  change. Returns true if a packet was sent.
+ */
+bool
+publisherAdd(publisher_t *pub, const dht_sample_t *sample);
+
+/*
+ *  Flush if the oldest pending sample reached maxLatencyMs. Call after
+ *  every wake-up. Returns true if a packet was sent.
+ */
+bool
+publisherPoll(publisher_t *pub);
+
+/*
+ *  Send whatever is pending now. Returns true if a packet was sent.
+ */
+bool
+publisherFlush(publisher_t *pub);
+
+/*
+ *  Ticks until the age limit forces a flush, portMAX_DELAY when nothing is
+ *  pending. Suitable as the consumer's receive timeout.
+ */
+TickType_t
+publisherTimeout(const publisher_t *pub);
+
+/*
+ *  Achieved samples per packet, in hundredths.
+ */
+uint32_t
+publisherSamplesPerPacket(const publisher_t *pub);
+
+#endif //_publisher_h_
@@ -0,0 +1,99 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_system.h"
+
+#include "rtc_batch.h"
+
+static const char *RTC_BATCH_TAG = "RTCBATCH";
+
+#define RTC_BATCH_MAGIC 0x52544331      // "RTC1"
+
+_Static_assert(sizeof(rtc_batch_t) <= RTC_BATCH_BYTES, "rtc_batch_t must fit in RTC user memory");
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * rtcBatchLoad - Public method to recover the batch after a wake.
+ *
+ * Returns false if RTC memory held no valid batch (cold boot).
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+bool
+rtcBatchLoad(rtc_batch_t *pBatch) {
+    if (system_rtc_mem_read(RTC_BATCH_BLOCK, pBatch, sizeof(rtc_batch_t)) &&
+        pBatch->magic == RTC_BATCH_MAGIC && pBatch->count <= RTC_BATCH_CAPACITY) {
+        return true;
+    }
+
+    // RTC memory holds garbage after power-on
+    memset(pBatch, 0, sizeof(rtc_batch_t));
+    pBatch->magic = RTC_BATCH_MAGIC;
+    return false;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * rtcBatchSave - Public method to keep the batch across deep sleep.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+bool
+rtcBatchSave(const rtc_batch_t *pBatch) {
+    // only the used part of the ring is written
+    uint32_t size = offsetof(rtc_batch_t, records) + pBatch->count * sizeof(rtc_record_t);
+    if (!system_rtc_mem_write(RTC_BATCH_BLOCK, pBatch, (size + 3) & ~3u)) {
+        ESP_LOGE(RTC_BATCH_TAG, "RtcBatch::save: RTC memory write failed. (%d)", __LINE__);
+        return false;
+    }
+    return true;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * rtcBatchAdd - Public method to record one reading of this wake.
+ *
+ * Returns false if the batch is full, the reading is counted as lost.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+bool
+rtcBatchAdd(rtc_batch_t *pBatch, uint8_t sensorId, dht_result_t result, const dht_data_t *data) {
+    if (pBatch->count >= RTC_BATCH_CAPACITY) {
+        pBatch->lost++;
+        return false;
+    }
+
+    rtc_record_t *pRecord = &pBatch->records[pBatch->count++];
+    pRecord->sensorId = sensorId;
+    pRecord->result = (uint8_t)result;
+    pRecord->csTemp = result == DHT_OK ? data->csTemp : 0;
+    pRecord->rh = result == DHT_OK ? data->rh : 0;
+    pRecord->wake = (uint16_t)(pBatch->wakes - pBatch->batchWake);
+    return true;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * rtcBatchSamples - Public method to expand records into bus samples.
+ *
+ * Returns number of samples written to out.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+uint32_t
+rtcBatchSamples(const rtc_batch_t *pBatch, dht_sample_t *out, uint32_t max, TickType_t intervalTicks) {
+    uint32_t count = pBatch->count < max ? pBatch->count : max;
+
+    for (uint32_t x=0; x<count; x++) {
+        const rtc_record_t *pRecord = &pBatch->records[x];
+        memset(&out[x], 0, sizeof(dht_sample_t));
+        out[x].sensorId = pRecord->sensorId;
+        out[x].result = pRecord->result;
+        out[x].csTemp = pRecord->csTemp;
+        out[x].rh = pRecord->rh;
+        out[x].ticks = (TickType_t)(pBatch->batchWake + pRecord->wake) * intervalTicks;
+    }
+
+    return count;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * rtcBatchClear - Public method to start a new batch with the next wake.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+void
+rtcBatchClear(rtc_batch_t *pBatch) {
+    pBatch->count = 0;
+    pBatch->batchWake = pBatch->wakes + 1;
+    pBatch->awakeMaxUs = 0;
+    pBatch->awakeSumUs = 0;
+}
@@ -0,0 +1,81 @@
+/*
+ *   RTC Batch
+ *   Sample ring kept in RTC user memory, which survives deep sleep, so a
+ *   duty-cycled node can take one reading per wake and only bring the
+ *   uplink up every few wakes to send the whole batch.
+ *
+ *   Timestamps are wake numbers: the sleep is shortened by the time spent
+ *   awake, so wakes are one read interval apart and are turned back into
+ *   ticks when the batch is expanded. The last sleep length is kept as the
+ *   wall-clock reference for the sensors' saved dht_state_t.
+ */
+
+#ifndef _rtc_batch_h_
+#define _rtc_batch_h_
+
+#include "dht22_ring.h"
+#include "dht22.h"
+
+#define RTC_BATCH_BLOCK     64      // first RTC user memory block, in 4 byte units
+#define RTC_BATCH_BYTES     512     // RTC user memory available to the application
+#define RTC_BATCH_SENSORS   4       // sensors whose dht_state_t is kept
+#define RTC_BATCH_CAPACITY  ((RTC_BATCH_BYTES - 36 - RTC_BATCH_SENSORS * 8) / 8)  // records after the header
+
+// one packed reading, 8 bytes
+typedef struct _rtc_record_t {
+    uint8_t  sensorId;
+    uint8_t  result;
+    int16_t  csTemp;
+    int16_t  rh;
+    uint16_t wake;          // wakes since the batch started
+}rtc_record_t;
+
+typedef struct _rtc_batch_t {
+    uint32_t     magic;
+    uint32_t     wakes;         // wakes since cold boot
+    uint32_t     batchWake;     // value of 'wakes' when the batch started
+    uint32_t     count;         // records held
+    uint32_t     awakeLastUs;   // last wake-to-sleep time
+    uint32_t     awakeMaxUs;
+    uint32_t     awakeSumUs;    // over the wakes of this batch, for the average
+    uint32_t     lost;          // readings dropped because the ring was full
+    uint32_t     sleepMs;       // length of the sleep that ended this wake
+    dht_state_t  sensors[RTC_BATCH_SENSORS];    // driver state, indexed like the records' sensorId
+    rtc_record_t records[RTC_BATCH_CAPACITY];
+}rtc_batch_t;
+
+/*
+ *  Load the batch from RTC memory. Returns false after a cold boot, the
+ *  batch is then reset to empty.
+ */
+bool
+rtcBatchLoad(rtc_batch_t *batch);
+
+/*
+ *  Write the batch back, call right before going to sleep.
+ */
+bool
+rtcBatchSave(const rtc_batch_t *batch);
+
+/*
+ *  Append the reading for the current wake. Returns false when full.
+ */
+bool
+rtcBatchAdd(rtc_batch_t *batch, uint8_t sensorId, dht_result_t result, const dht_data_t *data);
+
+/*
+ *  Expand up to 'max' records into samples, ticks spaced 'intervalTicks'
+ *  per wake. Returns the number written.
+ */
+uint32_t
+rtcBatchSamples(const rtc_batch_t *batch, dht_sample_t *out, uint32_t max, TickType_t intervalTicks);
+
+/*
+ *  Empty the batch after it was sent, keeping the wake counters. Call on
+ *  the flushing wake before 'wakes' is advanced; the next wake is the
+ *  first of the new batch.
+ */
+void
+rtcBatchClear(rtc_batch_t *batch);
+
+#endif //_rtc_batch_h_
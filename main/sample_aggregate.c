@@ -0,0 +1,181 @@
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+
+#include "sample_aggregate.h"
+
+static const char *AGGREGATE_TAG = "AGGREGATE";
+
+// Forward references
+static void aggregateMomentsAdd(aggregate_moments_t *, int16_t, uint16_t);
+static void aggregateMomentsResult(const aggregate_moments_t *, uint16_t, int16_t *, int16_t *, int16_t *, int16_t *);
+static void aggregateEmit(sample_aggregator_t *, uint8_t);
+static uint32_t aggregateSqrt(uint32_t);
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * sampleAggregateInitialize - Public method to prepare an aggregator.
+ *
+ * Inputs
+ *      pAgg     - caller-allocated aggregator.
+ *      windowMs - window length, at least one tick.
+ *      emit     - receives each closed window.
+ *      arg      - passed to emit.
+ *
+ * Returns dht_result_t.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+dht_result_t
+sampleAggregateInitialize(sample_aggregator_t *pAgg, uint32_t windowMs, sample_aggregate_emit_t emit, void *arg) {
+    if (pAgg == NULL || emit == NULL) {
+        ESP_LOGE(AGGREGATE_TAG, "Aggregate::initialize: inputs and 'emit' cannot be NULL. (%d)", __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    if (pdMS_TO_TICKS(windowMs) == 0) {
+        ESP_LOGE(AGGREGATE_TAG, "Aggregate::initialize: window %dms is shorter than a tick. (%d)", windowMs, __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    memset(pAgg, 0, sizeof(sample_aggregator_t));
+    pAgg->window = pdMS_TO_TICKS(windowMs);
+    pAgg->emit = emit;
+    pAgg->arg = arg;
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * sampleAggregateAdd - Public method to add one sample to its sensor's window.
+ *
+ * Notes
+ *      A window closes on the first sample past its end. The bus posts
+ *      every slot, failures included, so a window is emitted at most one
+ *      read interval late. Cached samples repeat a reading already counted
+ *      and are skipped.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+void
+sampleAggregateAdd(sample_aggregator_t *pAgg, const dht_sample_t *pSample) {
+    if (pSample->sensorId >= DHT_BUS_MAX_SENSORS || (pSample->flags & DHT_SAMPLE_FROM_CACHE)) {
+        return;
+    }
+
+    aggregate_window_t *pWindow = &pAgg->sensors[pSample->sensorId];
+    TickType_t start = pSample->ticks - pSample->ticks % pAgg->window;
+
+    if (pWindow->open && pWindow->start != start) {
+        aggregateEmit(pAgg, pSample->sensorId);
+    }
+
+    if (!pWindow->open) {
+        memset(pWindow, 0, sizeof(aggregate_window_t));
+        pWindow->open = true;
+        pWindow->start = start;
+    }
+
+    if (pSample->result != DHT_OK) {
+        pWindow->errors += pWindow->errors < UINT16_MAX ? 1 : 0;
+        return;
+    }
+
+    if (pWindow->count == UINT16_MAX) {
+        return;
+    }
+
+    aggregateMomentsAdd(&pWindow->temp, pSample->csTemp, pWindow->count);
+    aggregateMomentsAdd(&pWindow->rh, pSample->rh, pWindow->count);
+    pWindow->count++;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * sampleAggregateFlush - Public method to emit all open windows early.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+void
+sampleAggregateFlush(sample_aggregator_t *pAgg) {
+    for (int x=0; x<DHT_BUS_MAX_SENSORS; x++) {
+        if (pAgg->sensors[x].open) {
+            aggregateEmit(pAgg, (uint8_t)x);
+        }
+    }
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  aggregateEmit - Private method to turn a sensor's window into a record,
+ *                  hand it to the emit callback and close the window.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static void
+aggregateEmit(sample_aggregator_t *pAgg, uint8_t sensorId) {
+    aggregate_window_t *pWindow = &pAgg->sensors[sensorId];
+    sample_aggregate_t record;
+
+    memset(&record, 0, sizeof(sample_aggregate_t));
+    record.sensorId = sensorId;
+    record.count = pWindow->count;
+    record.errors = pWindow->errors;
+    record.start = pWindow->start;
+    if (pWindow->count > 0) {
+        aggregateMomentsResult(&pWindow->temp, pWindow->count, &record.tempMin, &record.tempMax, &record.tempMean, &record.tempStddev);
+        aggregateMomentsResult(&pWindow->rh, pWindow->count, &record.rhMin, &record.rhMax, &record.rhMean, &record.rhStddev);
+    }
+
+    pWindow->open = false;
+    pAgg->emitted++;
+    pAgg->emit(&record, pAgg->arg);
+}
+
+static void
+aggregateMomentsAdd(aggregate_moments_t *pMoments, int16_t value, uint16_t count) {
+    if (count == 0) {
+        pMoments->min = value;
+        pMoments->max = value;
+        pMoments->offset = value;
+    }
+
+    pMoments->min = value < pMoments->min ? value : pMoments->min;
+    pMoments->max = value > pMoments->max ? value : pMoments->max;
+
+    int32_t delta = (int32_t)value - pMoments->offset;
+    pMoments->sum += delta;
+    pMoments->sumSq += (int64_t)delta * delta;
+}
+
+// population statistics, mean and deviation rounded to the nearest tenth
+static void
+aggregateMomentsResult(const aggregate_moments_t *pMoments, uint16_t count, int16_t *pMin, int16_t *pMax,
+                       int16_t *pMean, int16_t *pStddev) {
+    int32_t half = count / 2;
+    int32_t mean = pMoments->sum >= 0 ? (pMoments->sum + half) / count : (pMoments->sum - half) / count;
+
+    // n^2 * variance = n * sum(d^2) - sum(d)^2, exact in 64 bits for a full window
+    int64_t n = count;
+    int64_t scaled = n * pMoments->sumSq - (int64_t)pMoments->sum * pMoments->sum;
+    uint32_t variance = scaled > 0 ? (uint32_t)((scaled + n * n / 2) / (n * n)) : 0;
+
+    *pMin = pMoments->min;
+    *pMax = pMoments->max;
+    *pMean = (int16_t)(pMoments->offset + mean);
+    *pStddev = (int16_t)aggregateSqrt(variance);
+}
+
+// integer square root rounded to nearest, bit by bit
+static uint32_t
+aggregateSqrt(uint32_t value) {
+    uint32_t root = 0;
+    uint32_t bit = 1u << 30;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return value > root ? root + 1 : root;
+}
@@ -0,0 +1,89 @@
+/*
+ *   Sample Aggregate
+ *   Streaming per-sensor aggregates over fixed time windows: count, min,
+ *   max, mean and standard deviation of temperature and humidity, in
+ *   constant memory however fast the sensors are read. One record per
+ *   sensor is emitted when a sample from the next window arrives; windows
+ *   are aligned on multiples of the window length since boot, like the
+ *   bus's aligned deadlines.
+ *
+ *   Sums are kept as exact integers relative to the window's first
+ *   reading, so the variance does not lose precision to cancellation and
+ *   no floating point is needed.
+ */
+
+#ifndef _sample_aggregate_h_
+#define _sample_aggregate_h_
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "dht22_bus.h"
+
+// one window of one sensor, tenths throughout
+typedef struct _sample_aggregate_t {
+    uint8_t    sensorId;
+    uint16_t   count;           // OK readings in the window, the fields below are 0 without any
+    uint16_t   errors;          // failed reads in the window
+    TickType_t start;           // tick count the window began
+    int16_t    tempMin;
+    int16_t    tempMax;
+    int16_t    tempMean;
+    int16_t    tempStddev;
+    int16_t    rhMin;
+    int16_t    rhMax;
+    int16_t    rhMean;
+    int16_t    rhStddev;
+}sample_aggregate_t;
+
+/*
+ *  Receives each closed window, runs in the caller of sampleAggregateAdd.
+ */
+typedef void (*sample_aggregate_emit_t)(const sample_aggregate_t *aggregate, void *arg);
+
+// running moments of one quantity
+typedef struct _aggregate_moments_t {
+    int16_t min;
+    int16_t max;
+    int16_t offset;             // first reading, sums are relative to it
+    int32_t sum;
+    int64_t sumSq;
+}aggregate_moments_t;
+
+typedef struct _aggregate_window_t {
+    bool                open;
+    TickType_t          start;
+    uint16_t            count;
+    uint16_t            errors;
+    aggregate_moments_t temp;
+    aggregate_moments_t rh;
+}aggregate_window_t;
+
+typedef struct _sample_aggregator_t {
+    TickType_t              window;     // length in ticks
+    sample_aggregate_emit_t emit;
+    void *                  arg;
+    aggregate_window_t      sensors[DHT_BUS_MAX_SENSORS];
+    uint32_t                emitted;
+}sample_aggregator_t;
+
+/*
+ *  Initialize a caller-allocated aggregator with 'windowMs' windows.
+ */
+dht_result_t
+sampleAggregateInitialize(sample_aggregator_t *agg, uint32_t windowMs, sample_aggregate_emit_t emit, void *arg);
+
+/*
+ *  Fold one sample in, first emitting the sensor's previous window if the
+ *  sample belongs to a later one.
+ */
+void
+sampleAggregateAdd(sample_aggregator_t *agg, const dht_sample_t *sample);
+
+/*
+ *  Emit every open window now, e.g. before going to sleep.
+ */
+void
+sampleAggregateFlush(sample_aggregator_t *agg);
+
+#endif //_sample_aggregate_h_
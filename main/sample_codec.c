@@ -0,0 +1,296 @@
+#include <string.h>
+
+#include "sample_codec.h"
+
+#define CODEC_LONG      0x80
+#define CODEC_RESULT    0x40
+#define CODEC_CACHED    0x20
+#define CODEC_PERIOD    0x10
+#define CODEC_TEMP      0x08
+#define CODEC_RH        0x04
+
+#define CODEC_BLOCK_MAX 255     // samples per block, count is one byte
+
+// bounded output cursor, 'ok' drops to false on the first overrun
+typedef struct _codecwriter {
+    uint8_t *p;
+    uint8_t *end;
+    bool     ok;
+}codecwriter_t;
+
+// Forward references
+static void codecPutByte(codecwriter_t *, uint8_t);
+static void codecPutVarint(codecwriter_t *, uint32_t);
+static bool codecGetByte(sample_decoder_t *, uint8_t *);
+static bool codecGetVarint(sample_decoder_t *, uint32_t *);
+
+static inline uint32_t
+codecZigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t
+codecUnzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * sampleEncode - Public method to encode a batch of samples.
+ *
+ * Inputs
+ *      samples - batch in arrival order, may mix sensors.
+ *      count   - number of samples.
+ *      out     - output buffer, SAMPLE_CODEC_MAX_BYTES(count) always fits.
+ *      outSize - size of out.
+ *
+ * Returns bytes written, 0 if the output did not fit.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+size_t
+sampleEncode(const dht_sample_t *samples, uint32_t count, uint8_t *out, size_t outSize) {
+    codecwriter_t w = { out, out + outSize, true };
+
+    codecPutByte(&w, SAMPLE_CODEC_VERSION);
+
+    for (uint32_t first=0; first<count; first++) {
+        // a sensor's block starts at its first sample in the batch
+        bool seen = false;
+        for (uint32_t x=0; x<first && !seen; x++) {
+            seen = samples[x].sensorId == samples[first].sensorId;
+        }
+        if (seen) {
+            continue;
+        }
+
+        uint8_t id = samples[first].sensorId;
+        uint32_t x = first;
+        while (x < count) {
+            while (x < count && samples[x].sensorId != id) {
+                x++;
+            }
+
+            uint32_t blockCount = 0;
+            for (uint32_t y=x; y<count && blockCount<CODEC_BLOCK_MAX; y++) {
+                blockCount += samples[y].sensorId == id ? 1 : 0;
+            }
+            if (blockCount == 0) {
+                break;
+            }
+
+            const dht_sample_t *pPrev = &samples[x];
+            int16_t temp = pPrev->csTemp, rh = pPrev->rh;
+            int32_t period = 0;
+
+            codecPutByte(&w, id);
+            codecPutByte(&w, (uint8_t)blockCount);
+            codecPutByte(&w, pPrev->result);
+            codecPutByte(&w, pPrev->flags);
+            codecPutVarint(&w, (uint32_t)pPrev->ticks);
+            codecPutVarint(&w, codecZigzag(temp));
+            codecPutVarint(&w, codecZigzag(rh));
+
+            uint32_t done = 1;
+            for (x=x+1; x<count && done<blockCount; x++) {
+                const dht_sample_t *pSample = &samples[x];
+                if (pSample->sensorId != id) {
+                    continue;
+                }
+
+                bool    ok = pSample->result == DHT_OK;
+                int32_t dPeriod = (int32_t)(pSample->ticks - pPrev->ticks) - period;
+                int32_t dTemp = ok ? pSample->csTemp - temp : 0;
+                int32_t dRh = ok ? pSample->rh - rh : 0;
+
+                if (ok && pSample->flags == 0 && dPeriod == 0 && dTemp >= -4 && dTemp <= 3 && dRh >= -8 && dRh <= 7) {
+                    codecPutByte(&w, (uint8_t)(((dTemp + 4) << 4) | (dRh + 8)));
+                } else {
+                    uint8_t tag = CODEC_LONG;
+                    tag |= ok ? 0 : CODEC_RESULT;
+                    tag |= (pSample->flags & DHT_SAMPLE_FROM_CACHE) ? CODEC_CACHED : 0;
+                    tag |= dPeriod != 0 ? CODEC_PERIOD : 0;
+                    tag |= dTemp != 0 ? CODEC_TEMP : 0;
+                    tag |= dRh != 0 ? CODEC_RH : 0;
+                    codecPutByte(&w, tag);
+                    if (!ok) {
+                        codecPutByte(&w, pSample->result);
+                    }
+                    if (dPeriod != 0) {
+                        codecPutVarint(&w, codecZigzag(dPeriod));
+                    }
+                    if (dTemp != 0) {
+                        codecPutVarint(&w, codecZigzag(dTemp));
+                    }
+                    if (dRh != 0) {
+                        codecPutVarint(&w, codecZigzag(dRh));
+                    }
+                }
+
+                period += dPeriod;
+                if (ok) {
+                    temp = pSample->csTemp;
+                    rh = pSample->rh;
+                }
+                pPrev = pSample;
+                done++;
+            }
+        }
+    }
+
+    return w.ok ? (size_t)(w.p - out) : 0;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * sampleDecoderInit - Public method to start walking an encoded packet.
+ *
+ * Returns false if the packet is empty or has an unknown version.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+bool
+sampleDecoderInit(sample_decoder_t *pDec, const uint8_t *data, size_t len) {
+    memset(pDec, 0, sizeof(sample_decoder_t));
+    if (data == NULL || len == 0 || data[0] != SAMPLE_CODEC_VERSION) {
+        return false;
+    }
+
+    pDec->p = data + 1;
+    pDec->end = data + len;
+    return true;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * sampleDecodeNext - Public method to decode one sample.
+ *
+ * Returns 1 when out was filled, 0 at the end, -1 on a corrupt packet.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+int
+sampleDecodeNext(sample_decoder_t *pDec, dht_sample_t *out) {
+    uint8_t  byte;
+    uint32_t value;
+
+    if (pDec->remaining == 0) {
+        if (pDec->p >= pDec->end) {
+            return 0;
+        }
+
+        // block header and its first, absolute, sample
+        dht_sample_t *pPrev = &pDec->prev;
+        memset(pPrev, 0, sizeof(dht_sample_t));
+        if (!codecGetByte(pDec, &pPrev->sensorId) || !codecGetByte(pDec, &pDec->remaining) || pDec->remaining == 0 ||
+            !codecGetByte(pDec, &pPrev->result) || !codecGetByte(pDec, &pPrev->flags) ||
+            !codecGetVarint(pDec, &value)) {
+            return -1;
+        }
+        pPrev->ticks = (TickType_t)value;
+
+        if (!codecGetVarint(pDec, &value)) {
+            return -1;
+        }
+        pPrev->csTemp = (int16_t)codecUnzigzag(value);
+
+        if (!codecGetVarint(pDec, &value)) {
+            return -1;
+        }
+        pPrev->rh = (int16_t)codecUnzigzag(value);
+
+        pDec->temp = pPrev->csTemp;
+        pDec->rh = pPrev->rh;
+        pDec->period = 0;
+        pDec->remaining--;
+        *out = *pPrev;
+        return 1;
+    }
+
+    if (!codecGetByte(pDec, &byte)) {
+        return -1;
+    }
+
+    dht_sample_t sample;
+    memset(&sample, 0, sizeof(dht_sample_t));
+    sample.sensorId = pDec->prev.sensorId;
+    sample.result = DHT_OK;
+
+    int32_t dTemp = 0, dRh = 0;
+    if (!(byte & CODEC_LONG)) {
+        dTemp = (int32_t)(byte >> 4) - 4;
+        dRh = (int32_t)(byte & 0x0f) - 8;
+    } else {
+        if ((byte & CODEC_RESULT) && !codecGetByte(pDec, &sample.result)) {
+            return -1;
+        }
+        sample.flags = (byte & CODEC_CACHED) ? DHT_SAMPLE_FROM_CACHE : 0;
+        if (byte & CODEC_PERIOD) {
+            if (!codecGetVarint(pDec, &value)) {
+                return -1;
+            }
+            pDec->period += codecUnzigzag(value);
+        }
+        if (byte & CODEC_TEMP) {
+            if (!codecGetVarint(pDec, &value)) {
+                return -1;
+            }
+            dTemp = codecUnzigzag(value);
+        }
+        if (byte & CODEC_RH) {
+            if (!codecGetVarint(pDec, &value)) {
+                return -1;
+            }
+            dRh = codecUnzigzag(value);
+        }
+    }
+
+    sample.ticks = pDec->prev.ticks + (TickType_t)pDec->period;
+    if (sample.result == DHT_OK) {
+        pDec->temp = (int16_t)(pDec->temp + dTemp);
+        pDec->rh = (int16_t)(pDec->rh + dRh);
+        sample.csTemp = pDec->temp;
+        sample.rh = pDec->rh;
+    }
+
+    pDec->prev = sample;
+    pDec->remaining--;
+    *out = sample;
+    return 1;
+}
+
+static void
+codecPutByte(codecwriter_t *pW, uint8_t byte) {
+    if (pW->p >= pW->end) {
+        pW->ok = false;
+        return;
+    }
+    *pW->p++ = byte;
+}
+
+// LEB128, 7 bits per byte, low group first
+static void
+codecPutVarint(codecwriter_t *pW, uint32_t value) {
+    while (value >= 0x80) {
+        codecPutByte(pW, (uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    codecPutByte(pW, (uint8_t)value);
+}
+
+static bool
+codecGetByte(sample_decoder_t *pDec, uint8_t *pByte) {
+    if (pDec->p >= pDec->end) {
+        return false;
+    }
+    *pByte = *pDec->p++;
+    return true;
+}
+
+static bool
+codecGetVarint(sample_decoder_t *pDec, uint32_t *pValue) {
+    uint32_t value = 0;
+    for (int shift=0; shift<35; shift+=7) {
+        uint8_t byte;
+        if (!codecGetByte(pDec, &byte)) {
+            return false;
+        }
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *pValue = value;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,61 @@
+/*
+ *   Sample Codec
+ *   Compact delta-encoded binary format for dht_sample_t batches, used for
+ *   uplink packets and the on-flash log.
+ *
+ *   Layout
+ *      packet = version byte, then one block per run of a sensor's samples
+ *      block  = sensorId, count, first sample (result, flags, ticks varint,
+ *               temp zigzag, rh zigzag), then count-1 delta samples
+ *      delta  = short form, 1 byte, when the tick period repeats and the
+ *               reading is a fresh OK one:
+ *                  0 ttt rrrr   temp delta -4..3, rh delta -8..7 (tenths)
+ *               long form otherwise:
+ *                  1 e c p t h 0 0  followed by the fields flagged
+ *                  e result byte, c from cache, p tick period change,
+ *                  t temp delta, h rh delta (zigzag varints)
+ *      Error samples carry no temp/rh and do not move the predictors.
+ */
+
+#ifndef _sample_codec_h_
+#define _sample_codec_h_
+
+#include <stddef.h>
+
+#include "dht22_ring.h"
+
+#define SAMPLE_CODEC_VERSION   1
+#define SAMPLE_CODEC_MAX_BYTES(count) (1 + (count) * 15)   // worst case encoded size
+
+/*
+ *  Encode 'count' samples, grouped per sensor in arrival order.
+ *  Returns bytes written, 0 if 'outSize' is too small.
+ */
+size_t
+sampleEncode(const dht_sample_t *samples, uint32_t count, uint8_t *out, size_t outSize);
+
+// streaming decoder state, walks a packet one sample at a time
+typedef struct _sample_decoder_t {
+    const uint8_t *p;
+    const uint8_t *end;
+    uint8_t        remaining;   // samples left in the current block
+    dht_sample_t   prev;        // last decoded sample of the block
+    int16_t        temp;        // temp/rh predictors, last OK values
+    int16_t        rh;
+    int32_t        period;      // tick delta predictor
+}sample_decoder_t;
+
+/*
+ *  Start decoding a packet. Returns false on an unknown version.
+ */
+bool
+sampleDecoderInit(sample_decoder_t *dec, const uint8_t *data, size_t len);
+
+/*
+ *  Decode the next sample. Returns 1 when 'out' was filled, 0 at the end of
+ *  the packet, -1 if the packet is truncated or corrupt.
+ */
+int
+sampleDecodeNext(sample_decoder_t *dec, dht_sample_t *out);
+
+#endif //_sample_codec_h_
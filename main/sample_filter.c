@@ -0,0 +1,165 @@
+#include <string.h>
+#include <stdlib.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+
+#include "sample_filter.h"
+
+static const char *FILTER_TAG = "FILTER";
+
+// Forward references
+static bool filterMoved(const sample_filter_t *, const sample_filter_sensor_t *, int16_t, int16_t);
+
+// median of three without sorting
+static inline int16_t
+filterMedian3(int16_t a, int16_t b, int16_t c) {
+    if (a > b) {
+        int16_t t = a;
+        a = b;
+        b = t;
+    }
+    if (b > c) {
+        b = c;
+    }
+    return a > b ? a : b;
+}
+
+// average back to tenths, rounded to nearest
+static inline int16_t
+filterRound(int32_t ema) {
+    return (int16_t)((ema + (1 << (SAMPLE_FILTER_EMA_FRACTION - 1))) >> SAMPLE_FILTER_EMA_FRACTION);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * sampleFilterInitialize - Public method to prepare a filter stage.
+ *
+ * Inputs
+ *      pFilter - caller-allocated filter.
+ *      pConfig - smoothing, deadbands and heartbeat, copied.
+ *
+ * Returns dht_result_t.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+dht_result_t
+sampleFilterInitialize(sample_filter_t *pFilter, const sample_filter_config_t *pConfig) {
+    if (pFilter == NULL || pConfig == NULL) {
+        ESP_LOGE(FILTER_TAG, "Filter::initialize: inputs cannot be NULL. (%d)", __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    if (pConfig->emaShift > 8 || pConfig->tempDeadband < 0 || pConfig->rhDeadband < 0) {
+        ESP_LOGE(FILTER_TAG, "Filter::initialize: emaShift must be in [0,8] and deadbands not negative. (%d)", __LINE__);
+        return DHT_INVALID_INPUT;
+    }
+
+    memset(pFilter, 0, sizeof(sample_filter_t));
+    pFilter->config = *pConfig;
+    return DHT_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * sampleFilterApply - Public method to filter one sample and decide whether it
+ *                     goes downstream.
+ *
+ * Returns true to forward the sample.
+ *
+ * Notes
+ *      Until a sensor has three readings the median is the newest one. A
+ *      cached reading repeats one the filter already saw and is held back.
+ *      The heartbeat forwards the current filtered value, so a quiet
+ *      sensor still shows it is alive without breaking the deadband.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+bool
+sampleFilterApply(sample_filter_t *pFilter, dht_sample_t *pSample) {
+    pFilter->received++;
+
+    if (pSample->result != DHT_OK || pSample->sensorId >= DHT_BUS_MAX_SENSORS) {
+        pFilter->forwarded++;
+        return true;
+    }
+
+    if (pSample->flags & DHT_SAMPLE_FROM_CACHE) {
+        return false;
+    }
+
+    sample_filter_sensor_t *pSensor = &pFilter->sensors[pSample->sensorId];
+    if (pSensor->seen == 3) {
+        memmove(&pSensor->temp[0], &pSensor->temp[1], 2 * sizeof(int16_t));
+        memmove(&pSensor->rh[0], &pSensor->rh[1], 2 * sizeof(int16_t));
+    } else {
+        pSensor->seen++;
+    }
+    pSensor->temp[pSensor->seen - 1] = pSample->csTemp;
+    pSensor->rh[pSensor->seen - 1] = pSample->rh;
+
+    int16_t temp = pSample->csTemp;
+    int16_t rh = pSample->rh;
+    if (pSensor->seen == 3) {
+        temp = filterMedian3(pSensor->temp[0], pSensor->temp[1], pSensor->temp[2]);
+        rh = filterMedian3(pSensor->rh[0], pSensor->rh[1], pSensor->rh[2]);
+        // a spike shows once a later reading brackets it: the middle reading is then
+        // the one the median rejects, on a ramp the middle always is the median
+        if (abs(pSensor->temp[1] - temp) > pFilter->config.tempDeadband || abs(pSensor->rh[1] - rh) > pFilter->config.rhDeadband) {
+            pFilter->glitches++;
+        }
+    }
+
+    int32_t scaledTemp = (int32_t)temp << SAMPLE_FILTER_EMA_FRACTION;
+    int32_t scaledRh = (int32_t)rh << SAMPLE_FILTER_EMA_FRACTION;
+    if (pSensor->seen == 1 || pFilter->config.emaShift == 0) {
+        pSensor->emaTemp = scaledTemp;
+        pSensor->emaRh = scaledRh;
+    } else {
+        pSensor->emaTemp += (scaledTemp - pSensor->emaTemp) >> pFilter->config.emaShift;
+        pSensor->emaRh += (scaledRh - pSensor->emaRh) >> pFilter->config.emaShift;
+    }
+
+    temp = filterRound(pSensor->emaTemp);
+    rh = filterRound(pSensor->emaRh);
+
+    bool heartbeat = false;
+    if (!filterMoved(pFilter, pSensor, temp, rh)) {
+        heartbeat = pFilter->config.heartbeatMs > 0 &&
+                    (pSample->ticks - pSensor->lastTicks) >= pdMS_TO_TICKS(pFilter->config.heartbeatMs);
+        if (!heartbeat) {
+            return false;
+        }
+    }
+
+    pSensor->forwarded = true;
+    pSensor->lastTemp = temp;
+    pSensor->lastRh = rh;
+    pSensor->lastTicks = pSample->ticks;
+
+    pSample->csTemp = temp;
+    pSample->rh = rh;
+    pFilter->forwarded++;
+    pFilter->heartbeats += heartbeat ? 1 : 0;
+    return true;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * sampleFilterPassRate - Public method to read the share of samples forwarded.
+ *
+ * Returns forwarded per hundred received, 100 before any sample.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+uint32_t
+sampleFilterPassRate(const sample_filter_t *pFilter) {
+    return pFilter->received > 0 ? (pFilter->forwarded * 100) / pFilter->received : 100;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  filterMoved - Private method, true if the filtered value left the deadband
+ *                around the last one forwarded, or nothing was forwarded yet.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static bool
+filterMoved(const sample_filter_t *pFilter, const sample_filter_sensor_t *pSensor, int16_t temp, int16_t rh) {
+    if (!pSensor->forwarded) {
+        return true;
+    }
+
+    return abs(temp - pSensor->lastTemp) > pFilter->config.tempDeadband ||
+           abs(rh - pSensor->lastRh) > pFilter->config.rhDeadband;
+}
@@ -0,0 +1,72 @@
+/*
+ *   Sample Filter
+ *   Stage between the bus and the publisher that forwards only readings
+ *   worth sending. Each sensor's readings go through a median of the last
+ *   three (rejects single-sample glitches), an exponential moving average
+ *   and a deadband against the last value forwarded; a heartbeat forwards
+ *   a sensor's current value at least every 'heartbeatMs' regardless.
+ *
+ *   Failed reads pass straight through and leave the filter untouched.
+ *   The driver's raw statistics (dhtGetStats) are not affected, the
+ *   counters here only describe what the stage held back.
+ */
+
+#ifndef _sample_filter_h_
+#define _sample_filter_h_
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "dht22_bus.h"
+
+#define SAMPLE_FILTER_EMA_FRACTION  4   // fractional bits kept by the moving average
+
+typedef struct _sample_filter_config_t {
+    uint8_t  emaShift;          // average weight 1/2^emaShift, 0 forwards the median as is
+    int16_t  tempDeadband;      // tenths C the filtered value must move before it is forwarded
+    int16_t  rhDeadband;        // tenths %RH, same as tempDeadband
+    uint32_t heartbeatMs;       // forward at least this often per sensor, 0 disables
+}sample_filter_config_t;
+
+// per-sensor filter state
+typedef struct _sample_filter_sensor_t {
+    uint8_t    seen;            // raw readings in the window, up to 3
+    int16_t    temp[3];         // last three raw readings, oldest first
+    int16_t    rh[3];
+    int32_t    emaTemp;         // averages, SAMPLE_FILTER_EMA_FRACTION fraction bits
+    int32_t    emaRh;
+    bool       forwarded;       // lastTemp/lastRh/lastTicks valid
+    int16_t    lastTemp;
+    int16_t    lastRh;
+    TickType_t lastTicks;
+}sample_filter_sensor_t;
+
+typedef struct _sample_filter_t {
+    sample_filter_config_t config;
+    sample_filter_sensor_t sensors[DHT_BUS_MAX_SENSORS];
+    uint32_t               received;    // samples offered
+    uint32_t               forwarded;   // samples passed downstream
+    uint32_t               heartbeats;  // of those, forwarded only because the heartbeat was due
+    uint32_t               glitches;    // single-reading spikes the median kept out of the average, counted one reading late
+}sample_filter_t;
+
+/*
+ *  Initialize a caller-allocated filter.
+ */
+dht_result_t
+sampleFilterInitialize(sample_filter_t *filter, const sample_filter_config_t *config);
+
+/*
+ *  Run one sample through the stage. Returns true if it should go
+ *  downstream; a fresh OK reading then carries the filtered values.
+ */
+bool
+sampleFilterApply(sample_filter_t *filter, dht_sample_t *sample);
+
+/*
+ *  Samples forwarded per hundred received.
+ */
+uint32_t
+sampleFilterPassRate(const sample_filter_t *filter);
+
+#endif //_sample_filter_h_
@@ -0,0 +1,356 @@
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "sample_log.h"
+
+static const char *SAMPLE_LOG_TAG = "SAMPLELOG";
+
+#define LOG_SECTOR_SIZE     4096
+#define LOG_SECTOR_MAGIC    0x31544844      // "DHT1"
+#define LOG_BLANK_LENGTH    0xffff
+
+// record states, each step only clears bits so it is a rewrite, not an erase
+#define LOG_STATE_WRITTEN   0xfe
+#define LOG_STATE_COMMITTED 0xfc
+#define LOG_STATE_CONSUMED  0xf8
+
+typedef struct _logsector {
+    uint32_t magic;
+    uint32_t seq;
+}logsector_t;
+
+typedef struct _logrecord {
+    uint16_t length;
+    uint8_t  state;
+    uint8_t  check;
+}logrecord_t;
+
+#define LOG_FIRST_RECORD    sizeof(logsector_t)
+
+// Forward references
+static bool logReadRecord(const sample_log_t *, uint32_t, uint32_t, logrecord_t *);
+static uint32_t logScanSector(const sample_log_t *, uint32_t, uint32_t *, uint32_t *);
+static esp_err_t logStartSector(sample_log_t *, uint32_t, uint32_t);
+static esp_err_t logAdvanceHead(sample_log_t *);
+static esp_err_t logSetState(const sample_log_t *, uint32_t, uint32_t, logrecord_t *, uint8_t);
+
+static inline uint32_t
+logPadded(uint32_t length) {
+    return (length + 3) & ~3u;
+}
+
+static inline size_t
+logAddress(uint32_t sector, uint32_t offset) {
+    return sector * LOG_SECTOR_SIZE + offset;
+}
+
+static uint8_t
+logCheck(const uint8_t *data, size_t size) {
+    uint8_t check = 0xa5;
+    for (size_t x=0; x<size; x++) {
+        check ^= data[x];
+    }
+    return check;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * sampleLogInitialize - Public method to mount the log partition.
+ *
+ * Inputs
+ *      pLog - caller-allocated log, keep it static, it holds a record buffer.
+ *
+ * Returns esp_err_t.
+ *
+ * Notes
+ *      Finds the newest sector by sequence number, then walks the ring from
+ *      the oldest one to rebuild the append offset, the replay cursor and
+ *      the pending count. Only record headers are read, not payloads.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+esp_err_t
+sampleLogInitialize(sample_log_t *pLog) {
+    if (pLog == NULL) {
+        ESP_LOGE(SAMPLE_LOG_TAG, "SampleLog::initialize: log cannot be NULL. (%d)", __LINE__);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(pLog, 0, sizeof(sample_log_t));
+    pLog->partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, SAMPLE_LOG_SUBTYPE, SAMPLE_LOG_LABEL);
+    if (pLog->partition == NULL) {
+        ESP_LOGE(SAMPLE_LOG_TAG, "SampleLog::initialize: no '%s' partition, check partitions.csv. (%d)", SAMPLE_LOG_LABEL, __LINE__);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    pLog->sectors = pLog->partition->size / LOG_SECTOR_SIZE;
+    if (pLog->sectors < 2) {
+        ESP_LOGE(SAMPLE_LOG_TAG, "SampleLog::initialize: partition needs at least 2 sectors. (%d)", __LINE__);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    bool found = false;
+    for (uint32_t x=0; x<pLog->sectors; x++) {
+        logsector_t header;
+        if (esp_partition_read(pLog->partition, logAddress(x, 0), &header, sizeof(header)) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        if (header.magic == LOG_SECTOR_MAGIC && (!found || (int32_t)(header.seq - pLog->headSeq) > 0)) {
+            found = true;
+            pLog->headSector = x;
+            pLog->headSeq = header.seq;
+        }
+    }
+
+    if (!found) {
+        ESP_LOGI(SAMPLE_LOG_TAG, "SampleLog::initialize: formatting %d sectors.", pLog->sectors);
+        esp_err_t err = logStartSector(pLog, 0, 1);
+        pLog->readSector = pLog->headSector;
+        pLog->readOffset = pLog->headOffset;
+        return err;
+    }
+
+    // sectors are used in turn, so the valid ones run from just after the
+    // head, around the ring, back to the head
+    bool cursor = false;
+    for (uint32_t k=1; k<=pLog->sectors; k++) {
+        uint32_t sector = (pLog->headSector + k) % pLog->sectors;
+        logsector_t header;
+        if (esp_partition_read(pLog->partition, logAddress(sector, 0), &header, sizeof(header)) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        if (header.magic != LOG_SECTOR_MAGIC) {
+            continue;
+        }
+
+        uint32_t end, first;
+        uint32_t pending = logScanSector(pLog, sector, &end, &first);
+        pLog->pending += pending;
+        if (pending > 0 && !cursor) {
+            cursor = true;
+            pLog->readSector = sector;
+            pLog->readOffset = first;
+        }
+        if (sector == pLog->headSector) {
+            pLog->headOffset = end;
+        }
+    }
+
+    if (!cursor) {
+        pLog->readSector = pLog->headSector;
+        pLog->readOffset = pLog->headOffset;
+    }
+
+    ESP_LOGI(SAMPLE_LOG_TAG, "SampleLog::initialize: %d packets pending, head sector %d seq %d.",
+                pLog->pending, pLog->headSector, pLog->headSeq);
+    return ESP_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * sampleLogAppend - Public method to log one encoded packet.
+ *
+ * Returns esp_err_t.
+ *
+ * Notes
+ *      The header goes down first as 'written', then the payload, then the
+ *      header is rewritten as 'committed'. A reset anywhere in between
+ *      leaves a record that mount and replay step over.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+esp_err_t
+sampleLogAppend(sample_log_t *pLog, const uint8_t *packet, size_t size) {
+    if (pLog->partition == NULL || packet == NULL || size == 0 || size > SAMPLE_LOG_MAX_RECORD) {
+        ESP_LOGE(SAMPLE_LOG_TAG, "SampleLog::append: invalid packet of %d bytes. (%d)", size, __LINE__);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint32_t padded = logPadded(size);
+    if (pLog->headOffset + sizeof(logrecord_t) + padded > LOG_SECTOR_SIZE) {
+        esp_err_t err = logAdvanceHead(pLog);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    uint8_t *staging = (uint8_t *)pLog->record;
+    memcpy(staging, packet, size);
+    memset(staging + size, 0xff, padded - size);
+
+    logrecord_t record = { (uint16_t)size, LOG_STATE_WRITTEN, logCheck(packet, size) };
+    size_t address = logAddress(pLog->headSector, pLog->headOffset);
+    esp_err_t err = esp_partition_write(pLog->partition, address, &record, sizeof(record));
+    if (err == ESP_OK) {
+        err = esp_partition_write(pLog->partition, address + sizeof(record), staging, padded);
+    }
+    if (err == ESP_OK) {
+        err = logSetState(pLog, pLog->headSector, pLog->headOffset, &record, LOG_STATE_COMMITTED);
+    }
+
+    // the space is used either way, a failed record is stepped over later
+    pLog->headOffset += sizeof(record) + padded;
+    if (err != ESP_OK) {
+        ESP_LOGE(SAMPLE_LOG_TAG, "SampleLog::append: flash write failed (%d). (%d)", err, __LINE__);
+        return err;
+    }
+
+    pLog->pending++;
+    return ESP_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * sampleLogReplay - Public method to send logged packets, oldest first.
+ *
+ * Returns true when nothing is left to replay.
+ *
+ * Notes
+ *      Streams one record at a time through the staging buffer, so the log
+ *      is never held in RAM. Must run on the same task as sampleLogAppend.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+bool
+sampleLogReplay(sample_log_t *pLog, sample_log_send_t send, void *arg) {
+    if (pLog->partition == NULL || send == NULL) {
+        return false;
+    }
+
+    while (pLog->readSector != pLog->headSector || pLog->readOffset < pLog->headOffset) {
+        logrecord_t record;
+        if (!logReadRecord(pLog, pLog->readSector, pLog->readOffset, &record)) {
+            if (pLog->readSector == pLog->headSector) {
+                break;
+            }
+            pLog->readSector = (pLog->readSector + 1) % pLog->sectors;
+            pLog->readOffset = LOG_FIRST_RECORD;
+            continue;
+        }
+
+        uint32_t offset = pLog->readOffset;
+        uint32_t next = offset + sizeof(record) + logPadded(record.length);
+        if (record.state != LOG_STATE_COMMITTED) {
+            pLog->readOffset = next;
+            continue;
+        }
+
+        uint8_t *staging = (uint8_t *)pLog->record;
+        size_t address = logAddress(pLog->readSector, offset + sizeof(record));
+        if (esp_partition_read(pLog->partition, address, staging, logPadded(record.length)) != ESP_OK) {
+            return false;
+        }
+
+        if (logCheck(staging, record.length) != record.check) {
+            pLog->corrupt++;
+            ESP_LOGW(SAMPLE_LOG_TAG, "SampleLog::replay: bad record in sector %d at %d skipped. (%d)",
+                        pLog->readSector, offset, __LINE__);
+        } else if (!send(staging, record.length, arg)) {
+            return false;
+        }
+
+        logSetState(pLog, pLog->readSector, offset, &record, LOG_STATE_CONSUMED);
+        pLog->readOffset = next;
+        if (pLog->pending > 0) {
+            pLog->pending--;
+        }
+    }
+
+    pLog->pending = 0;
+    return true;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  logReadRecord - Private method, reads the record header at offset.
+ *                  Returns false at the end of the sector's records.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static bool
+logReadRecord(const sample_log_t *pLog, uint32_t sector, uint32_t offset, logrecord_t *pRecord) {
+    if (offset + sizeof(logrecord_t) > LOG_SECTOR_SIZE ||
+        esp_partition_read(pLog->partition, logAddress(sector, offset), pRecord, sizeof(logrecord_t)) != ESP_OK) {
+        return false;
+    }
+
+    // a length that cannot fit means a torn header, nothing after it is usable
+    return pRecord->length != LOG_BLANK_LENGTH && pRecord->length != 0 &&
+           offset + sizeof(logrecord_t) + logPadded(pRecord->length) <= LOG_SECTOR_SIZE;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  logScanSector - Private method, walks a sector's record headers.
+ *                  Returns the committed, unconsumed count, with the end of
+ *                  the records and the first pending one (or end) in
+ *                  pEnd and pFirst.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static uint32_t
+logScanSector(const sample_log_t *pLog, uint32_t sector, uint32_t *pEnd, uint32_t *pFirst) {
+    uint32_t pending = 0;
+    uint32_t offset = LOG_FIRST_RECORD;
+    logrecord_t record = { LOG_BLANK_LENGTH, 0, 0 };
+
+    *pFirst = 0;
+    while (logReadRecord(pLog, sector, offset, &record)) {
+        if (record.state == LOG_STATE_COMMITTED) {
+            if (pending++ == 0) {
+                *pFirst = offset;
+            }
+        }
+        offset += sizeof(record) + logPadded(record.length);
+    }
+
+    // a torn header leaves the rest of the sector unusable for appends
+    *pEnd = offset + sizeof(record) <= LOG_SECTOR_SIZE && record.length != LOG_BLANK_LENGTH ? LOG_SECTOR_SIZE : offset;
+    if (pending == 0) {
+        *pFirst = *pEnd;
+    }
+    return pending;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  logStartSector - Private method, erases a sector and makes it the head.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static esp_err_t
+logStartSector(sample_log_t *pLog, uint32_t sector, uint32_t seq) {
+    logsector_t header = { LOG_SECTOR_MAGIC, seq };
+
+    esp_err_t err = esp_partition_erase_range(pLog->partition, logAddress(sector, 0), LOG_SECTOR_SIZE);
+    if (err == ESP_OK) {
+        err = esp_partition_write(pLog->partition, logAddress(sector, 0), &header, sizeof(header));
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(SAMPLE_LOG_TAG, "SampleLog::startSector: sector %d failed (%d). (%d)", sector, err, __LINE__);
+        return err;
+    }
+
+    pLog->headSector = sector;
+    pLog->headSeq = seq;
+    pLog->headOffset = LOG_FIRST_RECORD;
+    return ESP_OK;
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  logAdvanceHead - Private method, moves appends to the next sector. When
+ *                   the ring is full that is the oldest one, and whatever
+ *                   it still held unreplayed is lost.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static esp_err_t
+logAdvanceHead(sample_log_t *pLog) {
+    uint32_t next = (pLog->headSector + 1) % pLog->sectors;
+
+    if (pLog->readSector == next) {
+        uint32_t end, first;
+        uint32_t lost = logScanSector(pLog, next, &end, &first);
+        pLog->overwritten += lost;
+        pLog->pending -= lost < pLog->pending ? lost : pLog->pending;
+        pLog->readSector = (next + 1) % pLog->sectors;
+        pLog->readOffset = LOG_FIRST_RECORD;
+        if (lost > 0) {
+            ESP_LOGW(SAMPLE_LOG_TAG, "SampleLog::append: log full, %d packets overwritten (total %d). (%d)",
+                        lost, pLog->overwritten, __LINE__);
+        }
+    }
+
+    return logStartSector(pLog, next, pLog->headSeq + 1);
+}
+
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *  logSetState - Private method, rewrites a record header with a later
+ *                state, clearing bits only.
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+static esp_err_t
+logSetState(const sample_log_t *pLog, uint32_t sector, uint32_t offset, logrecord_t *pRecord, uint8_t state) {
+    pRecord->state = state;
+    return esp_partition_write(pLog->partition, logAddress(sector, offset), pRecord, sizeof(logrecord_t));
+}
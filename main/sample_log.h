@@ -0,0 +1,76 @@
+/*
+ *   Sample Log
+ *   Append-only log of encoded sample packets in a dedicated flash
+ *   partition, buffers uplink packets while the backhaul is down and
+ *   replays them in order when it returns.
+ *
+ *   The partition is used as a ring of 4 KB sectors, each starting with a
+ *   magic and a sequence number. Sectors are filled and erased strictly in
+ *   turn, so wear is spread evenly over the whole partition. Records never
+ *   span a sector; each is a 4 byte header (length, state, check) followed
+ *   by the packet padded to a word. The state byte only ever clears bits:
+ *   written -> committed -> consumed, so a record is committed only after
+ *   its payload is safely down and replay progress survives a reset
+ *   without an erase.
+ */
+
+#ifndef _sample_log_h_
+#define _sample_log_h_
+
+#include "esp_err.h"
+#include "esp_partition.h"
+
+#include "sample_codec.h"
+
+#define SAMPLE_LOG_LABEL        "dhtlog"
+#define SAMPLE_LOG_SUBTYPE      0x40        // custom data subtype in partitions.csv
+#define SAMPLE_LOG_MAX_RECORD   512         // largest packet accepted, in bytes
+
+/*
+ *  Replay sink, sends one logged packet. Returns false to stop the replay,
+ *  the packet stays in the log and is offered again next time.
+ */
+typedef bool (*sample_log_send_t)(const uint8_t *packet, size_t size, void *arg);
+
+typedef struct _sample_log_t {
+    const esp_partition_t *partition;
+    uint32_t               sectors;
+    uint32_t               headSector;  // sector being appended to
+    uint32_t               headSeq;
+    uint32_t               headOffset;  // next free byte in headSector
+    uint32_t               readSector;  // replay cursor
+    uint32_t               readOffset;
+    uint32_t               pending;     // committed records not yet replayed
+    uint32_t               overwritten; // unreplayed records lost when the ring wrapped
+    uint32_t               corrupt;     // records skipped on a bad check byte
+    uint32_t               record[SAMPLE_LOG_MAX_RECORD/4];  // word-aligned staging buffer for one record
+}sample_log_t;
+
+/*
+ *  Mount the log partition, formatting it if it holds no log yet.
+ */
+esp_err_t
+sampleLogInitialize(sample_log_t *log);
+
+/*
+ *  Append one encoded packet.
+ */
+esp_err_t
+sampleLogAppend(sample_log_t *log, const uint8_t *packet, size_t size);
+
+/*
+ *  Replay pending packets oldest first, marking each consumed once 'send'
+ *  accepts it. Returns true when the log is fully drained.
+ */
+bool
+sampleLogReplay(sample_log_t *log, sample_log_send_t send, void *arg);
+
+/*
+ *  Committed packets waiting for replay.
+ */
+static inline uint32_t
+sampleLogPending(const sample_log_t *log) {
+    return log->pending;
+}
+
+#endif //_sample_log_h_
@@ -3,11 +3,18 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "esp_system.h"
 #include "dht22.h"
+#include "dht22_bus.h"
+#include "dht22_event.h"
+#include "publisher.h"
+#include "sample_filter.h"
+#include "sample_aggregate.h"
+#include "sample_codec.h"
+#include "sample_log.h"
+#include "rtc_batch.h"
 
 /*
  *   Program: dht22 
@@ -15,45 +22,263 @@
  *   Author : hcurajr@hotmail.com
  *
  *   Description
- *   This program will use dht22 temperature & humidity sensor to periodically
+ *   This program will use dht22 temperature & humidity sensors to periodically
  *   print the temperature & humidity. The following pins will be used:
  *       gpio4: toggle green LED
  *       gpio5: communicate with dht22 DATA pin
+ *   Additional sensors are listed in gSensorConfig.
  */
 
-#define MAX_QUEUE_SIZE    10
+#define SAMPLE_BATCH_SIZE 8                         // samples drained from the bus per wake
+#define PUBLISH_BATCH_SIZE   16                     // samples per uplink packet
+#define PUBLISH_MAX_LATENCY  120000                 // in milli-seconds, oldest sample waits at most this long
+#define PUBLISH_TEMP_DELTA   10                     // in tenths C, change that is sent right away
+#define PUBLISH_RH_DELTA     50                     // in tenths %RH
+#define FILTER_EMA_SHIFT     2                      // moving average weight 1/4
+#define FILTER_TEMP_DEADBAND 2                      // in tenths C, smaller moves are not forwarded
+#define FILTER_RH_DEADBAND   10                     // in tenths %RH
+#define FILTER_HEARTBEAT     600000                 // in milli-seconds, forward each sensor at least this often
+#define AGGREGATE_WINDOW     60000                  // in milli-seconds, one min/max/mean/stddev record per sensor
 #define DHT_READ_INTERVAL 15000                     // Poll sensor every ~15 seconds
 #define DHT_SENSOR_NAME   "Daniel's Greenhouse"     // max 31 characters   
+#define DHT_RETRY_ATTEMPTS  2                       // retries of a failed capture within its read interval
+#define DHT_RETRY_BACKOFF   500                     // in milli-seconds, on top of the sensor's 2s minimum
+#define DHT_RETRY_JITTER    250                     // in milli-seconds
+#define DHT_ALIGN_SAMPLES   true                    // sample on multiples of the interval since boot
+#define DHT_LATE_WARN_MS    100                     // scheduling lateness worth a warning
+#define DHT_POWER_PIN       -1                      // GPIO switching the sensor's supply between reads, -1 if hard-wired
 
- typedef struct _dht_queue_entry_t {
-    dht_data_t dhtData;
-    dht_result_t result;
-}dht_queue_entry_t; 
+#ifndef DUTY_CYCLE_MODE
+#define DUTY_CYCLE_MODE   0                         // 1: one read per wake, deep sleep in between (GPIO16 wired to RST)
+#endif
+#define DUTY_FLUSH_WAKES  20                        // wakes between uplink flushes in duty-cycle mode
+#define DUTY_RF_DEFAULT   0                         // esp_deep_sleep_set_rf_option: RF up, calibration per init data
+#define DUTY_RF_DISABLED  4                         // esp_deep_sleep_set_rf_option: RF stays off after the wake
+#define DUTY_SLEEP_TAIL_US 16000                    // estimate after the wake is timed: one ~120 char log line at 74880 baud, RTC save, sleep entry
+
+#ifndef SINGLE_TASK_MODE
+#define SINGLE_TASK_MODE  0                         // 1: one task reads, filters and publishes, no bus task
+#endif
+#define SENSOR_TASK_STACK (configMINIMAL_STACK_SIZE<<2)
+#define HEALTH_REPORT_INTERVAL 300000               // in milli-seconds, stack and heap headroom log
+
+typedef struct _sensor_config_t {
+    gpio_num_t pin;
+    char       name[DHT_MAX_SENSOR_NAME];
+    uint32_t   intervalMs;
+    int8_t     powerPin;    // supply switch (active high), -1 for none
+}sensor_config_t;
+
+static sensor_config_t gSensorConfig[] = {
+    { GPIO_NUM_5, DHT_SENSOR_NAME, DHT_READ_INTERVAL, DHT_POWER_PIN },
+};
+
+#define SENSOR_COUNT (sizeof(gSensorConfig)/sizeof(gSensorConfig[0]))
 
 static const char *TAG = DHT_SENSOR_NAME;
 static bool gQUIT = false;
-static QueueHandle_t gQueueHandle;
+static dht_bus_t gBus;
+static dht_t *gDht[SENSOR_COUNT];
+static publisher_t gPublisher;
+static sample_filter_t gFilter;
+static sample_aggregator_t gAggregate;
+static sample_log_t gLog;
+static bool gLogReady = false;
+#if DUTY_CYCLE_MODE == 1
+static rtc_batch_t gBatch;
+#endif
+
+extern uint32_t ets_get_cpu_frequency(void);
+
+/*
+ * SendUplink hands one encoded packet to the backhaul. No network stack is
+ * brought up yet, so the packet is only logged and always delivered.
+ */
+static bool
+SendUplink(const uint8_t *packet, size_t size, void *arg) {
+    ESP_LOGI(TAG, "SendUplink: %d byte packet.", size);
+    return true;
+}
 
 /*
- * WriteSensorTask function reads DHT sensor data from Queue and publishes data to cloud.
+ * PublishPacket is the uplink transport for the publisher: one call is one packet.
+ * The batch is delta-encoded; while the backhaul is down packets go to the flash
+ * log, and the log is replayed first once it is back so ordering is kept.
+ */
+static bool
+PublishPacket(const dht_sample_t *samples, uint32_t count, void *arg) {
+    static uint8_t packet[SAMPLE_CODEC_MAX_BYTES(PUBLISH_BATCH_SIZE)];
+
+    size_t size = sampleEncode(samples, count, packet, sizeof(packet));
+    if (size == 0) {
+        ESP_LOGE(TAG, "PublishPacket: %d samples do not fit in %d bytes.", count, sizeof(packet));
+        return false;
+    }
+
+    ESP_LOGI(TAG, "PublishPacket: %d samples in %d bytes (raw %d), first sensor=%d ticks=%d, filter passes %d%%.",
+                count, size, count * sizeof(dht_sample_t), samples[0].sensorId, samples[0].ticks, sampleFilterPassRate(&gFilter));
+
+    bool drained = !gLogReady || sampleLogPending(&gLog) == 0 || sampleLogReplay(&gLog, SendUplink, NULL);
+    if (drained && SendUplink(packet, size, NULL)) {
+        return true;
+    }
+
+    // keep the samples pending in RAM if they could not be logged either
+    return gLogReady && sampleLogAppend(&gLog, packet, size) == ESP_OK;
+}
+
+/*
+ * PublishAggregate receives one closed window per sensor for long-term trending.
+ * Records are small and few, they are only logged until the backhaul takes them.
+ */
+static void
+PublishAggregate(const sample_aggregate_t *aggregate, void *arg) {
+    char min[DHT_TENTHS_STR_SIZE], max[DHT_TENTHS_STR_SIZE], mean[DHT_TENTHS_STR_SIZE], sd[DHT_TENTHS_STR_SIZE];
+    const char *name = aggregate->sensorId < SENSOR_COUNT ? gDht[aggregate->sensorId]->name : "?";
+
+    if (aggregate->count == 0) {
+        ESP_LOGW(TAG, "%s: window at %d has no readings, %d failed.", name, aggregate->start, aggregate->errors);
+        return;
+    }
+
+    ESP_LOGI(TAG, "%s: window at %d, %d readings (%d failed), Temperature %s..%s C mean %s sd %s",
+                name, aggregate->start, aggregate->count, aggregate->errors,
+                dhtFormatTenths(aggregate->tempMin, min), dhtFormatTenths(aggregate->tempMax, max),
+                dhtFormatTenths(aggregate->tempMean, mean), dhtFormatTenths(aggregate->tempStddev, sd));
+    ESP_LOGI(TAG, "%s: window at %d, Relative Humidity %s..%s%% mean %s sd %s",
+                name, aggregate->start,
+                dhtFormatTenths(aggregate->rhMin, min), dhtFormatTenths(aggregate->rhMax, max),
+                dhtFormatTenths(aggregate->rhMean, mean), dhtFormatTenths(aggregate->rhStddev, sd));
+}
+
+/*
+ * ReportHealth logs the stack never used by the reading and the publishing task
+ * (the same task in single-task mode) and the heap, to size both from real data,
+ * and what the driver learned about switched sensors.
+ */
+static void
+ReportHealth(void) {
+    dht_bus_health_t health;
+
+    if (dhtBusGetHealth(&gBus, &health) != DHT_OK) {
+        return;
+    }
+
+    #if SINGLE_TASK_MODE == 1
+    ESP_LOGI(TAG, "ReportHealth: stack free %d of %d, heap free %d (min %d).",
+                health.stackFree, SENSOR_TASK_STACK, health.heapFree, health.heapFreeMin);
+    #else
+    ESP_LOGI(TAG, "ReportHealth: bus stack free %d, writer stack free %d, of %d each, heap free %d (min %d).",
+                health.stackFree, uxTaskGetStackHighWaterMark(NULL), SENSOR_TASK_STACK, health.heapFree, health.heapFreeMin);
+    #endif
+
+    for (int x=0; x<SENSOR_COUNT; x++) {
+        dht_stats_t stats;
+        if (dhtGetStats(gDht[x], &stats) == DHT_OK && stats.powerSettleMs > 0) {
+            ESP_LOGI(TAG, "ReportHealth: '%s' settles in %dms after power-up, %d power cycles.",
+                        gDht[x]->name, stats.powerSettleMs, stats.powerCycles);
+        }
+    }
+}
+
+/*
+ * WriteSensorTask function drains DHT samples from the bus ring in batches and publishes data to cloud.
+ * In single-task mode it also runs the bus schedule itself through dhtBusPoll.
  */
 void 
 WriteSensorTask(void *input) {
-    dht_queue_entry_t dhtQEntry;
+    dht_sample_t samples[SAMPLE_BATCH_SIZE];
+    uint32_t overflow = 0;
+    publisher_config_t config = {
+        .batchSize = PUBLISH_BATCH_SIZE,
+        .maxLatencyMs = PUBLISH_MAX_LATENCY,
+        .tempDelta = PUBLISH_TEMP_DELTA,
+        .rhDelta = PUBLISH_RH_DELTA,
+        .send = PublishPacket,
+        .arg = NULL
+    };
+
+    if (publisherInitialize(&gPublisher, &config) != DHT_OK) {
+        ESP_LOGE(TAG, "WriteSensorTask: Failed to initialize publisher. (%d)", __LINE__);
+        vTaskDelete(NULL);
+        return;
+    }
+
+    if (sampleAggregateInitialize(&gAggregate, AGGREGATE_WINDOW, PublishAggregate, NULL) != DHT_OK) {
+        ESP_LOGE(TAG, "WriteSensorTask: Failed to initialize aggregator. (%d)", __LINE__);
+        vTaskDelete(NULL);
+        return;
+    }
+
+    const sample_filter_config_t filterConfig = { FILTER_EMA_SHIFT, FILTER_TEMP_DEADBAND, FILTER_RH_DEADBAND, FILTER_HEARTBEAT };
+    if (sampleFilterInitialize(&gFilter, &filterConfig) != DHT_OK) {
+        ESP_LOGE(TAG, "WriteSensorTask: Failed to initialize sample filter. (%d)", __LINE__);
+        vTaskDelete(NULL);
+        return;
+    }
+
+    // without the log, packets that fail to send wait in the publisher's batch
+    gLogReady = sampleLogInitialize(&gLog) == ESP_OK;
+    if (!gLogReady) {
+        ESP_LOGW(TAG, "WriteSensorTask: Sample log unavailable, offline buffering limited to RAM. (%d)", __LINE__);
+    }
 
+    TickType_t lastHealth = xTaskGetTickCount();
     while (!gQUIT) {
-        if (xQueueReceive(gQueueHandle, &dhtQEntry, pdMS_TO_TICKS(DHT_READ_INTERVAL)) == pdTRUE) {
-            if (dhtQEntry.result == DHT_OK) {
-                ESP_LOGI(TAG, "Temperature %d.%d F (%d.%d C), Relative Humidity %d.%d%%", 
-                            dhtQEntry.dhtData.faTempWhole, 
-                            dhtQEntry.dhtData.faTempFraction, 
-                            dhtQEntry.dhtData.csTempWhole, 
-                            dhtQEntry.dhtData.csTempFraction,
-                            dhtQEntry.dhtData.rhWhole, 
-                            dhtQEntry.dhtData.rhFraction);
+        // wakes once every sensor has reported, after one read interval with whatever arrived,
+        // or sooner when the publisher's oldest sample is due
+        TickType_t timeout = publisherTimeout(&gPublisher);
+        if (timeout > pdMS_TO_TICKS(DHT_READ_INTERVAL)) {
+            timeout = pdMS_TO_TICKS(DHT_READ_INTERVAL);
+        }
+
+        #if SINGLE_TASK_MODE == 1
+        uint32_t count = dhtBusPoll(&gBus, samples, SAMPLE_BATCH_SIZE, timeout);
+        #else
+        uint32_t count = dhtBusReceive(&gBus, samples, SAMPLE_BATCH_SIZE, timeout);
+        #endif
+        for (uint32_t x=0; x<count; x++) {
+            // aggregates see every raw reading; only readings that moved, and heartbeats, go upstream
+            sampleAggregateAdd(&gAggregate, &samples[x]);
+            dht_sample_t filtered = samples[x];
+            if (sampleFilterApply(&gFilter, &filtered)) {
+                publisherAdd(&gPublisher, &filtered);
+            }
+
+            dht_bus_stats_t stats;
+            dhtBusGetStats(&gBus, samples[x].sensorId, &stats);
+            if (stats.lateLastMs >= DHT_LATE_WARN_MS) {
+                ESP_LOGW(TAG, "%s: Read started %dms late (max %dms, %d deadlines missed).",
+                            gDht[samples[x].sensorId]->name, stats.lateLastMs, stats.lateMaxMs, stats.missed);
+            }
+
+            if (samples[x].result == DHT_OK) {
+                char fa[DHT_TENTHS_STR_SIZE], cs[DHT_TENTHS_STR_SIZE], rh[DHT_TENTHS_STR_SIZE];
+                ESP_LOGI(TAG, "%s: Temperature %s F (%s C), Relative Humidity %s%%", 
+                            gDht[samples[x].sensorId]->name,
+                            dhtFormatTenths(dhtCelsiusToFahrenheit(samples[x].csTemp), fa), 
+                            dhtFormatTenths(samples[x].csTemp, cs), 
+                            dhtFormatTenths(samples[x].rh, rh));
+            } else {
+                ESP_LOGW(TAG, "%s: Read failed (Error=%d), retries %d, recovered %d, exhausted %d, stalled %d.",
+                            gDht[samples[x].sensorId]->name, samples[x].result, stats.retries, stats.recovered, stats.exhausted, stats.stalled);
             }
-        } else {
-            ESP_LOGE(TAG, "WriteSensorTask: Failed to read from Queue.");
+        }
+
+        publisherPoll(&gPublisher);
+
+        // driver failures are recorded by whichever task or timer callback ran the read
+        // (bus task, dhtBusPoll or the async read timer), format them here where logging is cheap
+        dhtEventFlush();
+
+        if (dhtBusOverflow(&gBus) != overflow) {
+            overflow = dhtBusOverflow(&gBus);
+            ESP_LOGW(TAG, "WriteSensorTask: %d samples dropped so far, consumer is falling behind.", overflow);
+        }
+
+        if (xTaskGetTickCount() - lastHealth >= pdMS_TO_TICKS(HEALTH_REPORT_INTERVAL)) {
+            lastHealth = xTaskGetTickCount();
+            ReportHealth();
         }
     } 
     
@@ -61,53 +286,206 @@ WriteSensorTask(void *input) {
     vTaskDelete(NULL);
 }
 
+#if DUTY_CYCLE_MODE == 1
+/*
+ * CyclesSinceReset reads the Xtensa CCOUNT register, which starts from zero on
+ * every reset (deep sleep wake included), so it times the whole wake.
+ */
+static inline uint32_t
+CyclesSinceReset(void) {
+    uint32_t ccount;
+    __asm__ __volatile__("rsr %0, ccount" : "=a"(ccount));
+    return ccount;
+}
+
+/*
+ * FlushDue is true if wake 'wake', holding 'count' samples once its readings are
+ * added, has to flush: DUTY_FLUSH_WAKES is reached or another wake would not fit.
+ * Before sleeping it predicts the next wake from a full set of readings; a wake
+ * can only add fewer, so one predicted not to flush never does.
+ */
+static bool
+FlushDue(uint32_t wake, uint32_t count) {
+    return wake - gBatch.batchWake + 1 >= DUTY_FLUSH_WAKES || count + SENSOR_COUNT > RTC_BATCH_CAPACITY;
+}
+
+/*
+ * FlushBatch brings the uplink up and publishes every sample held in RTC memory.
+ * RunDutyCycle only leaves RF enabled for the wake that calls this, every other
+ * wake boots with the radio disabled and skips its calibration. Returns true once
+ * everything was sent; RunDutyCycle clears the batch after timing this wake.
+ */
+static bool
+FlushBatch(void) {
+    static dht_sample_t samples[RTC_BATCH_CAPACITY];
+    uint32_t count = rtcBatchSamples(&gBatch, samples, RTC_BATCH_CAPACITY, pdMS_TO_TICKS(DHT_READ_INTERVAL));
+    uint32_t wakes = gBatch.wakes - gBatch.batchWake + 1;
+    bool sent = true;
+
+    gLogReady = sampleLogInitialize(&gLog) == ESP_OK;
+    for (uint32_t x=0; x<count && sent; x+=PUBLISH_BATCH_SIZE) {
+        sent = PublishPacket(&samples[x], count - x < PUBLISH_BATCH_SIZE ? count - x : PUBLISH_BATCH_SIZE, NULL);
+    }
+
+    ESP_LOGI(TAG, "FlushBatch: %d samples from %d wakes, %d lost, %s.",
+                count, wakes, gBatch.lost, sent ? "sent" : "kept for the next wake");
+    return sent;
+}
+
+/*
+ * RunDutyCycle is one wake of duty-cycle mode: read every sensor once, append the
+ * readings to the RTC batch, flush it every DUTY_FLUSH_WAKES wakes and deep sleep
+ * until the next read interval. Does not return.
+ */
+static void
+RunDutyCycle(void) {
+    bool warm = rtcBatchLoad(&gBatch);
+    uint32_t elapsedMs = gBatch.sleepMs + CyclesSinceReset() / ets_get_cpu_frequency() / 1000;
+
+    for (int x=0; x<SENSOR_COUNT; x++) {
+        dht_data_t data;
+        dht_result_t result = dhtInitialize(gSensorConfig[x].pin, gSensorConfig[x].name, &gDht[x]);
+
+        if (result == DHT_OK) {
+            // the sensor stays powered through deep sleep, so its last read
+            // and calibration still hold; after a cold boot it needs the full wait
+            if (warm && x < RTC_BATCH_SENSORS) {
+                dhtRestoreState(gDht[x], &gBatch.sensors[x], elapsedMs);
+            }
+            vTaskDelay(dhtTicksUntilReady(gDht[x]));
+            result = dhtRead(gDht[x], &data);
+        }
+
+        if (!rtcBatchAdd(&gBatch, (uint8_t)x, result, &data)) {
+            ESP_LOGW(TAG, "RunDutyCycle: RTC batch full, reading of '%s' lost.", gSensorConfig[x].name);
+        }
+    }
+
+    bool flushed = FlushDue(gBatch.wakes, gBatch.count) && FlushBatch();
+
+    for (int x=0; x<SENSOR_COUNT; x++) {
+        if (gDht[x] != NULL) {
+            if (x < RTC_BATCH_SENSORS) {
+                dhtSaveState(gDht[x], &gBatch.sensors[x]);
+            }
+            dhtCleanup(&gDht[x]);
+        }
+    }
+    dhtEventFlush();
+
+    // from reset to sleep, bootloader included, what follows is estimated; the sleep 
+    // gives back the time spent awake
+    uint32_t awakeUs = CyclesSinceReset() / ets_get_cpu_frequency() + DUTY_SLEEP_TAIL_US;
+    uint32_t intervalUs = DHT_READ_INTERVAL * 1000;
+    uint32_t sleepUs = awakeUs < intervalUs ? intervalUs - awakeUs : 1000;
+
+    // this wake, flush included, counts in the batch its readings went into
+    gBatch.awakeLastUs = awakeUs;
+    gBatch.awakeSumUs += awakeUs;
+    if (awakeUs > gBatch.awakeMaxUs) {
+        gBatch.awakeMaxUs = awakeUs;
+    }
+    uint32_t batchWakes = gBatch.wakes - gBatch.batchWake + 1;
+    uint32_t avgUs = gBatch.awakeSumUs / batchWakes;
+    uint32_t maxUs = gBatch.awakeMaxUs;
+    if (flushed) {
+        rtcBatchClear(&gBatch);
+    }
+    gBatch.sleepMs = sleepUs / 1000;
+    gBatch.wakes++;
+
+    // RF power-up and calibration is most of a wake's energy, only the flushing wake gets it
+    bool flushNext = FlushDue(gBatch.wakes, gBatch.count + SENSOR_COUNT);
+    esp_deep_sleep_set_rf_option(flushNext ? DUTY_RF_DEFAULT : DUTY_RF_DISABLED);
+    rtcBatchSave(&gBatch);
+
+    if (flushed) {
+        ESP_LOGI(TAG, "RunDutyCycle: wake %d awake %d us, batch of %d wakes avg %d us max %d us, RF %s next wake.",
+                    gBatch.wakes, awakeUs, batchWakes, avgUs, maxUs, flushNext ? "on" : "off");
+    } else {
+        ESP_LOGI(TAG, "RunDutyCycle: wake %d awake %d us, %d samples batched, RF %s next wake.",
+                    gBatch.wakes, awakeUs, gBatch.count, flushNext ? "on" : "off");
+    }
+    esp_deep_sleep(sleepUs);
+}
+#endif
+
 /* 
- * ReadSensorTask reads Temperature and Relative Humidity data from 
- * DHT22 Sensor and writes it to queue for processing.
+ * StartSensors initializes every sensor in gSensorConfig and hands them to the
+ * bus manager, whose single task reads them and writes results to its sample ring.
+ * In single-task mode the bus is only configured, WriteSensorTask polls it.
  */
-void 
-ReadSensorTask(void *input) {
-    dht_t *pDht = NULL;
-    dht_queue_entry_t dhtQEntry;
- 
-    if ((dhtQEntry.result = dhtInitialize(GPIO_NUM_5, DHT_SENSOR_NAME, &pDht)) != DHT_OK) {
-        ESP_LOGE(TAG, "ReadSensorTask: Failed to initialize DHT22 Sensor! Exiting (Error=%d).", dhtQEntry.result);
-        gQUIT = true;
-        return;
+static bool
+StartSensors(void) {
+    dht_result_t result;
+
+    if ((result = dhtBusInitialize(&gBus, SENSOR_COUNT)) != DHT_OK) {
+        ESP_LOGE(TAG, "StartSensors: Failed to initialize DHT bus (Error=%d). (%d)", result, __LINE__);
+        return false;
     }
 
-    // wait a full 2sec cycle before reading from sensor for first time
-    vTaskDelay(pdMS_TO_TICKS(2000));
-    while (!gQUIT) {
-        dhtQEntry.result = dhtRead(pDht, &dhtQEntry.dhtData);
-        if (xQueueSendToBack(gQueueHandle, &dhtQEntry, pdMS_TO_TICKS(1000)) != pdTRUE) {
-            ESP_LOGE(TAG, "ReadSensorTask: Failed to add entry to queue.");      
+    for (int x=0; x<SENSOR_COUNT; x++) {
+        if ((result = dhtInitialize(gSensorConfig[x].pin, gSensorConfig[x].name, &gDht[x])) != DHT_OK) {
+            ESP_LOGE(TAG, "StartSensors: Failed to initialize DHT22 Sensor '%s' (Error=%d).", gSensorConfig[x].name, result);
+            return false;
         }
 
-        vTaskDelay(pdMS_TO_TICKS(DHT_READ_INTERVAL));
+        #if DHT_BENCH == 1
+        dhtBenchSampling(gDht[x]);
+        #endif
+
+        // powered only around its reads, and power-cycled by the driver if it hangs
+        if (gSensorConfig[x].powerPin >= 0) {
+            const dht_power_t power = { (uint8_t)gSensorConfig[x].powerPin, true, true };
+            if ((result = dhtSetPower(gDht[x], &power)) != DHT_OK) {
+                ESP_LOGE(TAG, "StartSensors: Failed to set power pin of '%s' (Error=%d).", gSensorConfig[x].name, result);
+                return false;
+            }
+        }
+
+        if ((result = dhtBusAdd(&gBus, gDht[x], gSensorConfig[x].intervalMs, NULL)) != DHT_OK) {
+            ESP_LOGE(TAG, "StartSensors: Failed to add '%s' to DHT bus (Error=%d).", gSensorConfig[x].name, result);
+            return false;
+        }
     }
 
-    ESP_LOGE(TAG, "ReadSensorTask: QUIT signal is TRUE. Task exitng loop. (%d)", __LINE__);
-    vTaskDelete(NULL);
+    const dht_bus_retry_t retry = { DHT_RETRY_ATTEMPTS, DHT_RETRY_BACKOFF, DHT_RETRY_JITTER };
+    if ((result = dhtBusSetRetry(&gBus, &retry)) != DHT_OK) {
+        ESP_LOGE(TAG, "StartSensors: Failed to set DHT bus retry policy (Error=%d). (%d)", result, __LINE__);
+        return false;
+    }
+
+    if ((result = dhtBusSetAligned(&gBus, DHT_ALIGN_SAMPLES)) != DHT_OK) {
+        ESP_LOGE(TAG, "StartSensors: Failed to set DHT bus alignment (Error=%d). (%d)", result, __LINE__);
+        return false;
+    }
+
+    #if SINGLE_TASK_MODE == 0
+    if ((result = dhtBusStart(&gBus, 5, SENSOR_TASK_STACK)) != DHT_OK) {
+        ESP_LOGE(TAG, "StartSensors: Failed to start DHT bus (Error=%d). (%d)", result, __LINE__);
+        return false;
+    }
+    #endif
+
+    return true;
 }
 
 void 
 app_main(void)
 {
-    gQueueHandle = xQueueCreate(MAX_QUEUE_SIZE, sizeof(dht_queue_entry_t));
-    if (gQueueHandle == NULL) {
-        ESP_LOGE(TAG, "Insufficient heap-memory to create Queue Handle. Program Exiting. (%d)", __LINE__);
-        return;
-    }
+    #if DUTY_CYCLE_MODE == 1
+    RunDutyCycle();
+    #endif
 
-    if (xTaskCreate(&ReadSensorTask,  "ReadSensorTask",  configMINIMAL_STACK_SIZE<<2, NULL, 5, NULL) == pdFAIL) {
-        ESP_LOGE(TAG, "Failed to create ReadSensorTask. Program exiting. (%d)", __LINE__);
+    if (!StartSensors()) {
+        ESP_LOGE(TAG, "Failed to start sensors. Program exiting. (%d)", __LINE__);
         return;
     }
 
-    if (xTaskCreate(&WriteSensorTask, "WriteSensorTask", configMINIMAL_STACK_SIZE<<2, NULL, 4, NULL) == pdFAIL) {
+    // reading sensors itself, the single task takes the bus task's priority
+    if (xTaskCreate(&WriteSensorTask, "WriteSensorTask", SENSOR_TASK_STACK, NULL, SINGLE_TASK_MODE ? 5 : 4, NULL) == pdFAIL) {
         gQUIT = true;
+        dhtBusStop(&gBus);
         ESP_LOGE(TAG, "Failed to create WriteSensorTask. Program exiting. (%d)", __LINE__);
     }
 }
-
@@ -0,0 +1,408 @@
+/*
+ *   DHT22 Waveform Replay
+ *   Host-side harness that feeds synthetic or recorded DATA line waveforms
+ *   through the firmware decoder (components/dht22/dht22_decode.c) and
+ *   reports decode throughput and accuracy against ground truth.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dht22_decode.h"
+
+#define REPLAY_MAX_EDGES      88    // same capacity as the ISR capture buffer (DHT_MAX_EDGES)
+#define REPLAY_MAX_SEGMENTS   256
+#define REPLAY_MIN_BENCH_NS   500000000ull
+#define REPLAY_MAX_CHANGES    (REPLAY_MAX_SEGMENTS * 3)   // a glitch splits a segment in three
+#define REPLAY_MAX_WORDS      512   // 8 ms of line samples at one per micro-second
+#define REPLAY_MIN_RUN        4     // samples, as DHT_DMA_MIN_RUN_US at one sample per micro-second
+
+// bit timing from the DHT22 spec sheet, in micro-seconds
+#define RELEASE_TAIL_US       20    // MCU's release HIGH still on the line when capture starts
+#define RESPONSE_LOW_US       80
+#define RESPONSE_HIGH_US      80
+#define BIT_LOW_US            50
+#define BIT_ZERO_US           27
+#define BIT_ONE_US            70
+
+// one constant-level stretch of the DATA line
+typedef struct _segment {
+    uint8_t level;
+    double  us;
+}segment_t;
+
+// one captured frame, as the ISR would have recorded it
+typedef struct _capture {
+    uint32_t ccount[REPLAY_MAX_EDGES];
+    uint8_t  level[REPLAY_MAX_EDGES];
+    int      edgeCount;
+    uint8_t  truth[DHT_FRAME_SIZE];
+}capture_t;
+
+typedef struct _options {
+    int      frames;
+    uint32_t mhz;
+    double   thresholdUs;
+    double   jitterUs;      // uniform +/- per segment
+    double   skewPct;       // sensor clock error, stretches every sensor-driven segment
+    double   glitchPct;     // chance per segment of an opposite-level spike
+    uint32_t seed;
+    const char *file;       // recorded waveform, NULL for synthetic frames
+    bool     hasExpected;
+    uint8_t  expected[DHT_FRAME_SIZE];
+    double   minAccuracy;   // exit non-zero when frame accuracy falls below, percent
+    bool     calibrate;     // rescale the threshold to each frame's response, as the firmware does
+    bool     sampled;       // capture as the I2S DMA backend does, one sample per micro-second
+}options_t;
+
+static uint32_t gRandom = 1;
+
+// xorshift32, reproducible across hosts for a given seed
+static uint32_t
+replayRandom(void) {
+    gRandom ^= gRandom << 13;
+    gRandom ^= gRandom >> 17;
+    gRandom ^= gRandom << 5;
+    return gRandom;
+}
+
+// uniform in [-1, 1]
+static double
+replayUniform(void) {
+    return (double)replayRandom() / 2147483647.5 - 1.0;
+}
+
+static void
+replayUsage(const char *prog) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -n frames   frames to replay (default 10000)\n"
+        "  -m mhz      CPU clock used for cycle counts (default 80)\n"
+        "  -t us       bit threshold (default %d)\n"
+        "  -c          calibrate the threshold from each frame's response HIGH\n"
+        "  -d          capture by oversampling like the DMA backend, not edge by edge\n"
+        "  -j us       uniform timing jitter per segment (default 0)\n"
+        "  -s pct      sensor clock skew (default 0)\n"
+        "  -g pct      glitch chance per segment (default 0)\n"
+        "  -r seed     random seed (default 1)\n"
+        "  -f file     recorded waveform, lines of '<level> <duration-us>'\n"
+        "  -x hex      expected frame for -f, 10 hex digits\n"
+        "  -a pct      fail when frame accuracy is below pct\n",
+        prog, DHT_BIT_THRESHOLD_US);
+}
+
+// build the segments of a frame as the sensor would send it
+static int
+replaySynthesize(const uint8_t *frame, segment_t *segs) {
+    int count = 0;
+
+    segs[count++] = (segment_t){1, RELEASE_TAIL_US};
+    segs[count++] = (segment_t){0, RESPONSE_LOW_US};
+    segs[count++] = (segment_t){1, RESPONSE_HIGH_US};
+    for (int x=0; x<DHT_FRAME_BITS; x++) {
+        int bit = (frame[x>>3] >> (7 - (x & 7))) & 1;
+        segs[count++] = (segment_t){0, BIT_LOW_US};
+        segs[count++] = (segment_t){1, bit ? BIT_ONE_US : BIT_ZERO_US};
+    }
+    segs[count++] = (segment_t){0, BIT_LOW_US};
+    segs[count++] = (segment_t){1, 0};      // line back to idle
+
+    return count;
+}
+
+// read a recorded waveform, returns number of segments or -1
+static int
+replayLoad(const char *path, segment_t *segs) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    char line[128];
+    int count = 0;
+    while (fgets(line, sizeof(line), f) != NULL && count < REPLAY_MAX_SEGMENTS) {
+        unsigned level;
+        double us;
+        if (line[0] == '#' || sscanf(line, "%u %lf", &level, &us) != 2) {
+            continue;
+        }
+        segs[count++] = (segment_t){(uint8_t)(level ? 1 : 0), us};
+    }
+
+    fclose(f);
+    return count;
+}
+
+// rasterize recorded edges to one sample per micro-second and run-length
+// decode them back, as the DMA backend sees the line
+static void
+replaySample(const uint32_t *changeAt, const uint8_t *changeLevel, int changeCount, const options_t *opt, capture_t *cap) {
+    uint16_t words[REPLAY_MAX_WORDS];
+    uint32_t ccount[REPLAY_MAX_EDGES];
+    int      y = 0;
+
+    memset(words, 0, sizeof(words));
+    for (uint32_t x=0; x<REPLAY_MAX_WORDS * 16; x++) {
+        uint32_t cycles = x * opt->mhz;
+        while (y + 1 < changeCount && changeAt[y + 1] <= cycles) {
+            y++;
+        }
+        uint8_t level = changeCount > 0 ? changeLevel[y] : 1;
+        words[x >> 4] |= (uint16_t)(level << (15 - (x & 15)));
+    }
+
+    cap->edgeCount = dhtSamplesToEdges(words, REPLAY_MAX_WORDS, REPLAY_MIN_RUN, ccount, cap->level, REPLAY_MAX_EDGES);
+    for (int x=0; x<cap->edgeCount; x++) {
+        cap->ccount[x] = ccount[x] * opt->mhz;
+    }
+}
+
+// apply skew, jitter and glitches, then record level changes like dhtEdgeIsr
+static void
+replayCapture(const segment_t *segs, int segCount, const options_t *opt, capture_t *cap) {
+    double t = 0;
+    int last = -1;
+    // the sampled capture has no edge limit, it is rasterized from every change
+    uint32_t changeAt[REPLAY_MAX_CHANGES];
+    uint8_t  changeLevel[REPLAY_MAX_CHANGES];
+    uint32_t *pAt = opt->sampled ? changeAt : cap->ccount;
+    uint8_t  *pLevel = opt->sampled ? changeLevel : cap->level;
+    int      limit = opt->sampled ? REPLAY_MAX_CHANGES : REPLAY_MAX_EDGES;
+    int      count = 0;
+    for (int x=0; x<segCount; x++) {
+        double us = segs[x].us;
+        // the release tail is driven by the MCU, everything after by the sensor
+        if (x > 0) {
+            us = us * (1.0 + opt->skewPct / 100.0) + opt->jitterUs * replayUniform();
+        }
+        if (us < 0) {
+            us = 0;
+        }
+
+        double spikeAt = -1, spikeUs = 0;
+        if (opt->glitchPct > 0 && (replayRandom() % 10000) < opt->glitchPct * 100) {
+            spikeUs = 1 + 2 * (replayUniform() + 1) / 2;
+            spikeAt = (us - spikeUs) * (replayUniform() + 1) / 2;
+        }
+
+        uint8_t levels[3] = {segs[x].level, (uint8_t)!segs[x].level, segs[x].level};
+        double  starts[3] = {t, t + spikeAt, t + spikeAt + spikeUs};
+        int     parts = spikeAt >= 0 ? 3 : 1;
+
+        for (int y=0; y<parts; y++) {
+            if (levels[y] == last || count >= limit) {
+                continue;
+            }
+            pAt[count] = (uint32_t)(starts[y] * opt->mhz);
+            pLevel[count++] = levels[y];
+            last = levels[y];
+        }
+        t += us;
+    }
+
+    if (opt->sampled) {
+        replaySample(changeAt, changeLevel, count, opt, cap);
+    } else {
+        cap->edgeCount = count;
+    }
+}
+
+static uint64_t
+replayNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// humidity and temperature in tenths, as reported by dht_data_t
+static void
+replayTenths(const dht_data_t *data, int *rh, int *temp) {
+    *rh = data->rh;
+    *temp = data->csTemp;
+}
+
+static bool
+replayParseHex(const char *hex, uint8_t *frame) {
+    if (strlen(hex) != DHT_FRAME_SIZE * 2) {
+        return false;
+    }
+    for (int x=0; x<DHT_FRAME_SIZE; x++) {
+        unsigned byte;
+        if (sscanf(hex + x * 2, "%2x", &byte) != 1) {
+            return false;
+        }
+        frame[x] = (uint8_t)byte;
+    }
+    return true;
+}
+
+int
+main(int argc, char **argv) {
+    options_t opt = {10000, 80, DHT_BIT_THRESHOLD_US, 0, 0, 0, 1, NULL, false, {0}, -1, false, false};
+    int c;
+
+    while ((c = getopt(argc, argv, "n:m:t:j:s:g:r:f:x:a:cdh")) != -1) {
+        switch (c) {
+        case 'n': opt.frames = atoi(optarg); break;
+        case 'm': opt.mhz = (uint32_t)atoi(optarg); break;
+        case 't': opt.thresholdUs = atof(optarg); break;
+        case 'j': opt.jitterUs = atof(optarg); break;
+        case 's': opt.skewPct = atof(optarg); break;
+        case 'g': opt.glitchPct = atof(optarg); break;
+        case 'r': opt.seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'f': opt.file = optarg; break;
+        case 'x':
+            if (!replayParseHex(optarg, opt.expected)) {
+                fprintf(stderr, "-x needs %d hex digits\n", DHT_FRAME_SIZE * 2);
+                return 2;
+            }
+            opt.hasExpected = true;
+            break;
+        case 'a': opt.minAccuracy = atof(optarg); break;
+        case 'c': opt.calibrate = true; break;
+        case 'd': opt.sampled = true; break;
+        default:
+            replayUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (opt.frames <= 0 || opt.mhz == 0) {
+        replayUsage(argv[0]);
+        return 2;
+    }
+
+    gRandom = opt.seed != 0 ? opt.seed : 1;
+
+    segment_t recorded[REPLAY_MAX_SEGMENTS];
+    int recordedCount = 0;
+    if (opt.file != NULL && (recordedCount = replayLoad(opt.file, recorded)) <= 0) {
+        fprintf(stderr, "%s: no waveform segments\n", opt.file);
+        return 2;
+    }
+
+    capture_t *caps = calloc((size_t)opt.frames, sizeof(capture_t));
+    if (caps == NULL) {
+        fprintf(stderr, "out of memory for %d frames\n", opt.frames);
+        return 2;
+    }
+
+    // generate every capture up front so the timed loop only decodes
+    for (int x=0; x<opt.frames; x++) {
+        segment_t synth[REPLAY_MAX_SEGMENTS];
+        const segment_t *segs = recorded;
+        int segCount = recordedCount;
+
+        if (opt.file == NULL) {
+            int rh = (int)(replayRandom() % 1001);
+            int temp = (int)(replayRandom() % 1201) - 400;
+            // an all zero frame is rejected as a stuck line, keep truth decodable
+            rh = rh == 0 && temp == 0 ? 1 : rh;
+            uint16_t rawTemp = temp < 0 ? (uint16_t)(0x8000 | -temp) : (uint16_t)temp;
+            caps[x].truth[0] = (uint8_t)(rh >> 8);
+            caps[x].truth[1] = (uint8_t)rh;
+            caps[x].truth[2] = (uint8_t)(rawTemp >> 8);
+            caps[x].truth[3] = (uint8_t)rawTemp;
+            caps[x].truth[4] = (uint8_t)(caps[x].truth[0] + caps[x].truth[1] + caps[x].truth[2] + caps[x].truth[3]);
+            segCount = replaySynthesize(caps[x].truth, synth);
+            segs = synth;
+        } else {
+            memcpy(caps[x].truth, opt.expected, DHT_FRAME_SIZE);
+        }
+
+        replayCapture(segs, segCount, &opt, &caps[x]);
+    }
+
+    uint32_t nominal = (uint32_t)(opt.thresholdUs * opt.mhz);
+    bool     haveTruth = opt.file == NULL || opt.hasExpected;
+    int      complete = 0, checksumOk = 0, exact = 0, falseAccept = 0, valueOk = 0;
+    long     bitErrors = 0;
+
+    for (int x=0; x<opt.frames; x++) {
+        uint8_t frame[DHT_FRAME_SIZE] = {0};
+        dht_data_t data;
+        int pulses;
+        uint32_t threshold = opt.calibrate ? dhtCalibrateEdges(caps[x].ccount, caps[x].level, caps[x].edgeCount, nominal, nominal) : nominal;
+
+        if (dhtDecodeEdges(caps[x].ccount, caps[x].level, caps[x].edgeCount, threshold, frame, &pulses, NULL) != DHT_OK) {
+            continue;
+        }
+        complete++;
+
+        for (int y=0; y<DHT_FRAME_SIZE; y++) {
+            bitErrors += __builtin_popcount(frame[y] ^ caps[x].truth[y]);
+        }
+
+        bool match = memcmp(frame, caps[x].truth, DHT_FRAME_SIZE) == 0;
+        exact += match ? 1 : 0;
+
+        if (dhtDecodeFrame(frame, &data) != DHT_OK) {
+            continue;
+        }
+        checksumOk++;
+
+        if (!haveTruth) {
+            continue;
+        }
+        if (!match) {
+            falseAccept++;
+            continue;
+        }
+
+        int rh, temp;
+        uint16_t rawTemp = (uint16_t)((caps[x].truth[2] << 8) | caps[x].truth[3]);
+        int truthTemp = (rawTemp & 0x8000) ? -(int)(rawTemp & 0x7fff) : (int)rawTemp;
+        replayTenths(&data, &rh, &temp);
+        if (rh == ((caps[x].truth[0] << 8) | caps[x].truth[1]) && temp == truthTemp) {
+            valueOk++;
+        }
+    }
+
+    // throughput: decode the whole set repeatedly for at least REPLAY_MIN_BENCH_NS
+    volatile uint32_t sink = 0;
+    uint64_t decoded = 0;
+    uint64_t start = replayNow(), elapsed;
+    do {
+        for (int x=0; x<opt.frames; x++) {
+            uint8_t frame[DHT_FRAME_SIZE] = {0};
+            dht_data_t data;
+            int pulses;
+            uint32_t threshold = opt.calibrate ? dhtCalibrateEdges(caps[x].ccount, caps[x].level, caps[x].edgeCount, nominal, nominal) : nominal;
+            if (dhtDecodeEdges(caps[x].ccount, caps[x].level, caps[x].edgeCount, threshold, frame, &pulses, NULL) == DHT_OK &&
+                dhtDecodeFrame(frame, &data) == DHT_OK) {
+                sink += (uint32_t)data.rh;
+            }
+        }
+        decoded += (uint64_t)opt.frames;
+        elapsed = replayNow() - start;
+    } while (elapsed < REPLAY_MIN_BENCH_NS);
+
+    double accuracy = 100.0 * exact / opt.frames;
+    printf("source      : %s\n", opt.file != NULL ? opt.file : "synthetic");
+    printf("conditions  : %u MHz%s, threshold %.1f us%s, jitter %.1f us, skew %.2f%%, glitch %.2f%%, seed %u\n",
+           opt.mhz, opt.sampled ? " (sampled 1/us)" : "", opt.thresholdUs, opt.calibrate ? " (calibrated)" : "", opt.jitterUs, opt.skewPct, opt.glitchPct, opt.seed);
+    printf("frames      : %d\n", opt.frames);
+    printf("complete    : %d (%.2f%%)\n", complete, 100.0 * complete / opt.frames);
+    printf("checksum ok : %d (%.2f%%)\n", checksumOk, 100.0 * checksumOk / opt.frames);
+    if (haveTruth) {
+        printf("frame exact : %d (%.2f%%)\n", exact, accuracy);
+        printf("values ok   : %d (%.2f%%)\n", valueOk, 100.0 * valueOk / opt.frames);
+        printf("bit errors  : %ld (%.4f%% of decoded bits)\n", bitErrors,
+               complete > 0 ? 100.0 * bitErrors / ((double)complete * DHT_FRAME_BITS) : 0.0);
+        printf("false accept: %d\n", falseAccept);
+    }
+    printf("throughput  : %.0f frames/s (%.1f ns/frame)\n",
+           decoded * 1e9 / elapsed, (double)elapsed / decoded);
+
+    free(caps);
+
+    if (haveTruth && opt.minAccuracy >= 0 && accuracy < opt.minAccuracy) {
+        fprintf(stderr, "frame accuracy %.2f%% below %.2f%%\n", accuracy, opt.minAccuracy);
+        return 1;
+    }
+    return 0;
+}